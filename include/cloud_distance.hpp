@@ -0,0 +1,250 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/map.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/tuple.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <nanoflann.hpp>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <tuple>
+#include <vector>
+
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// Running reductions of nearest neighbor distances
+template <typename real_t>
+struct DistanceStats
+{
+    double size   = 0.0;
+    double sum    = 0.0;  // sum of the distances
+    double sum_sq = 0.0;  // sum of the square distances
+    real_t min    = std::numeric_limits<real_t>::infinity();
+    real_t max    = real_t(0.0);
+
+    void add(const real_t sq_dist)
+    {
+        const real_t dist = std::sqrt(sq_dist);
+        size += 1.0;
+        sum += dist;
+        sum_sq += sq_dist;
+        min = std::min(min, dist);
+        max = std::max(max, dist);
+    }
+
+    void merge(const DistanceStats& other)
+    {
+        size += other.size;
+        sum += other.sum;
+        sum_sq += other.sum_sq;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+/**
+ * Compute the distance from each query point to its nearest point in the reference point cloud, in one parallel pass.
+ *
+ * Only the distance of the nearest neighbor is kept, no index is stored. Queries are processed by blocks, each block
+ * reducing its own distances, and the block reductions are merged in order so the result does not depend on the
+ * scheduling.
+ *
+ * @param data the reference point cloud.
+ * @param query the compared point cloud.
+ * @param distances [n_queries] the distance of each query point to the reference point cloud, nullptr if they are not
+ * needed.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the reductions of the distances of all the query points.
+ */
+template <typename real_t>
+static DistanceStats<real_t> nearest_distances(
+    RefCloud<real_t> data, RefCloud<real_t> query, real_t* distances, const std::string& backend)
+{
+    constexpr size_t block_size = 1024;
+
+    if (data.rows() == 0 || query.rows() == 0) { throw std::invalid_argument("point clouds should not be empty"); }
+
+    const size_t                       n_points = static_cast<size_t>(query.rows());
+    const size_t                       n_blocks = (n_points + block_size - 1) / block_size;
+    std::vector<DistanceStats<real_t>> block_stats(n_blocks);
+    const std::array<real_t, 3>        weights = {real_t(1.0), real_t(1.0), real_t(1.0)};
+
+    with_search_index(
+        data, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_blocks, size_t(1),
+                [&](size_t i_block)
+                {
+                    DistanceStats<real_t> stats;
+                    const size_t          end = std::min(n_points, (i_block + 1) * block_size);
+                    for (size_t point_id = i_block * block_size; point_id < end; ++point_id)
+                    {
+                        uint32_t neighbor;
+                        real_t   sq_dist;
+                        nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(1);
+                        result_set.init(&neighbor, &sq_dist);
+                        index.findNeighbors(result_set, query.row(point_id).data());
+                        stats.add(sq_dist);
+                        if (distances != nullptr) { distances[point_id] = std::sqrt(sq_dist); }
+                    }
+                    block_stats[i_block] = stats;
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    DistanceStats<real_t> stats;
+    for (const auto& block : block_stats) { stats.merge(block); }
+    return stats;
+}
+
+/**
+ * Compute percentiles of a set of values, with the linear interpolation of numpy.percentile.
+ *
+ * Values are partially sorted in place, percentiles being processed in ascending order so that each selection only
+ * runs on the values above the previous one.
+ *
+ * @param values the values, reordered by the function.
+ * @param percentiles the requested percentiles, in [0, 100].
+ * @return the value of each requested percentile, in the order of 'percentiles'.
+ */
+template <typename real_t>
+static std::vector<real_t> compute_percentiles(std::vector<real_t>& values, const std::vector<real_t>& percentiles)
+{
+    std::vector<size_t> order(percentiles.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return percentiles[a] < percentiles[b]; });
+
+    std::vector<real_t> result(percentiles.size());
+    auto                first = values.begin();
+    for (const size_t i : order)
+    {
+        // In double precision, as a float position is not exact beyond 2^24 values
+        const double position = double(percentiles[i]) / 100.0 * static_cast<double>(values.size() - 1);
+        const size_t lower    = static_cast<size_t>(std::floor(position));
+        const auto   nth      = values.begin() + lower;
+        std::nth_element(first, nth, values.end());
+        first = nth;
+        // The next value is the smallest of the values above the lower one
+        const real_t low  = *nth;
+        const real_t high = lower + 1 < values.size() ? *std::min_element(nth + 1, values.end()) : low;
+        result[i]         = low + static_cast<real_t>(position - static_cast<double>(lower)) * (high - low);
+    }
+    return result;
+}
+
+/**
+ * Compute the cloud-to-cloud (C2C) distance between two point clouds: the distance from each point of the compared
+ * point cloud ('query') to its nearest point in the reference point cloud ('data'), and its reductions.
+ *
+ * @param data the reference point cloud.
+ * @param query the compared point cloud.
+ * @param percentiles the percentiles of the distances to compute, in [0, 100].
+ * @param return_distances whether the distance of each query point should be returned.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return a tuple with a dict of reductions ('mean', 'rms', 'min', 'max', 'max' being the one-sided Hausdorff
+ * distance), an nd::array of the requested percentiles, and the distance of each query point (None if
+ * return_distances is false).
+ */
+template <typename real_t>
+static std::tuple<
+    std::map<std::string, real_t>, nb::ndarray<nb::numpy, real_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>>>
+    cloud_to_cloud_distance(
+        RefCloud<real_t> data, RefCloud<real_t> query, const std::vector<real_t>& percentiles,
+        const bool return_distances, const std::string& backend)
+{
+    for (const real_t percentile : percentiles)
+    {
+        if (!(percentile >= real_t(0.0) && percentile <= real_t(100.0)))
+        {
+            throw std::invalid_argument("percentiles should be in [0, 100]");
+        }
+    }
+
+    // Distances are only stored if they are returned or needed by the percentiles
+    const size_t        n_points = static_cast<size_t>(query.rows());
+    std::vector<real_t> buffer;
+    real_t*             distances = nullptr;
+    nb::capsule         owner_distances;
+    if (return_distances)
+    {
+        distances       = new real_t[n_points];
+        owner_distances = nb::capsule(distances, [](void* p) noexcept { delete[] (real_t*)p; });
+    }
+    else if (!percentiles.empty())
+    {
+        buffer.resize(n_points);
+        distances = buffer.data();
+    }
+
+    const DistanceStats<real_t>   stats = nearest_distances(data, query, distances, backend);
+    std::map<std::string, real_t> reductions;
+    reductions["mean"] = static_cast<real_t>(stats.sum / stats.size);
+    reductions["rms"]  = static_cast<real_t>(std::sqrt(stats.sum_sq / stats.size));
+    reductions["min"]  = stats.min;
+    reductions["max"]  = stats.max;
+
+    real_t* percentile_values = new real_t[percentiles.size()];
+    nb::capsule owner_percentiles(percentile_values, [](void* p) noexcept { delete[] (real_t*)p; });
+    if (!percentiles.empty())
+    {
+        // Returned distances are left untouched, the selection runs on a copy
+        if (return_distances) { buffer.assign(distances, distances + n_points); }
+        const std::vector<real_t> values = compute_percentiles(buffer, percentiles);
+        std::copy(values.begin(), values.end(), percentile_values);
+    }
+
+    const size_t shape_percentiles[1] = {percentiles.size()};
+    const size_t shape_distances[1]   = {n_points};
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>> out_distances;
+    if (return_distances)
+    {
+        out_distances = nb::ndarray<nb::numpy, real_t, nb::ndim<1>>(distances, 1, shape_distances, owner_distances);
+    }
+    return {
+        reductions,
+        nb::ndarray<nb::numpy, real_t, nb::ndim<1>>(percentile_values, 1, shape_percentiles, owner_percentiles),
+        out_distances};
+}
+
+/**
+ * Compute the Chamfer distance between two point clouds, i.e. the sum of the mean square distances from each point
+ * cloud to its nearest points in the other one. Both directions are computed in parallel passes, no distance nor index
+ * array is allocated.
+ *
+ * @param a the first point cloud.
+ * @param b the second point cloud.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the Chamfer distance.
+ */
+template <typename real_t>
+static real_t chamfer_distance(RefCloud<real_t> a, RefCloud<real_t> b, const std::string& backend)
+{
+    const DistanceStats<real_t> a_to_b = nearest_distances<real_t>(b, a, nullptr, backend);
+    const DistanceStats<real_t> b_to_a = nearest_distances<real_t>(a, b, nullptr, backend);
+    return static_cast<real_t>(a_to_b.sum_sq / a_to_b.size + b_to_a.sum_sq / b_to_a.size);
+}
+
+}  // namespace pgeof
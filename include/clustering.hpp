@@ -0,0 +1,335 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <vector>
+
+#include "nn_search.hpp"
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+/**
+ * A concurrent union-find over a fixed number of elements. Merges are lock-free: a root is linked to the other root
+ * with a compare-and-swap, always towards the lowest index so that the root of a set is its lowest element. Finds
+ * compress the paths by halving.
+ */
+class ConcurrentUnionFind
+{
+   public:
+    explicit ConcurrentUnionFind(const size_t size) : parent_(size)
+    {
+        for (size_t i = 0; i < size; ++i) { parent_[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed); }
+    }
+
+    uint32_t find(uint32_t i)
+    {
+        while (true)
+        {
+            uint32_t parent = parent_[i].load(std::memory_order_relaxed);
+            if (parent == i) { return i; }
+            const uint32_t grandparent = parent_[parent].load(std::memory_order_relaxed);
+            if (grandparent != parent)
+            {
+                parent_[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            }
+            i = grandparent;
+        }
+    }
+
+    void unite(uint32_t a, uint32_t b)
+    {
+        while (true)
+        {
+            a = find(a);
+            b = find(b);
+            if (a == b) { return; }
+            if (a < b) { std::swap(a, b); }
+            // a may have been linked by another thread since it was found, then retry
+            uint32_t expected = a;
+            if (parent_[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) { return; }
+        }
+    }
+
+   private:
+    std::vector<std::atomic<uint32_t>> parent_;
+};
+
+// Root of the elements which do not belong to any cluster
+constexpr uint32_t no_root = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Number clusters from the root of each element, by increasing root index, in a single ordered pass. The root of a
+ * cluster should belong to it.
+ *
+ * @param root the root of the cluster of each element, or no_root.
+ * @param min_cluster_size the clusters with less elements are labeled as noise.
+ * @param point_of a callable returning the index (in labels) of an element.
+ * @param labels the labels to fill, only the elements of a cluster are written. -1 for the noise.
+ */
+template <typename PointOf>
+static void label_clusters(
+    const std::vector<uint32_t>& root, const uint32_t min_cluster_size, PointOf&& point_of, int32_t* labels)
+{
+    const size_t          n_elements = root.size();
+    std::vector<uint32_t> size(n_elements, 0);
+    for (size_t i = 0; i < n_elements; ++i)
+    {
+        if (root[i] != no_root) { ++size[root[i]]; }
+    }
+    std::vector<int32_t> cluster_of(n_elements, -1);
+    int32_t              n_clusters = 0;
+    for (size_t i = 0; i < n_elements; ++i)
+    {
+        if (root[i] == i && size[i] >= min_cluster_size) { cluster_of[i] = n_clusters++; }
+    }
+    for (size_t i = 0; i < n_elements; ++i)
+    {
+        if (root[i] != no_root) { labels[point_of(i)] = cluster_of[root[i]]; }
+    }
+}
+
+/**
+ * Cluster a point cloud with DBSCAN (Ester et al. 1996), in parallel.
+ *
+ * A point is a core point if it has at least 'min_points' points (itself included) within 'eps'. Core points within
+ * 'eps' of each other belong to the same cluster, and the other points within 'eps' of a core point (border points)
+ * join its cluster. Other points are noise. It proceeds in two parallel radius searches, none of which stores the
+ * neighbors: the first counts the neighbors of each point, stopping at 'min_points', and the second merges the core
+ * points with their core neighbors in a concurrent union-find. A border point joins the cluster of its lowest core
+ * neighbor, so the labels do not depend on the number of threads.
+ *
+ * With 'min_points' = 1, every point is a core point, and the clusters are the connected components of the points
+ * within 'eps' of each other (Euclidean cluster extraction).
+ *
+ * @param xyz the point cloud.
+ * @param eps the radius of the neighborhoods.
+ * @param min_points the minimum number of points of the neighborhood of a core point, itself included.
+ * @param min_cluster_size the clusters with less points are labeled as noise.
+ * @param mask optional [n_points] mask of the points to cluster, e.g. computed from features. The other points are
+ * labeled as noise, and are ignored by the neighborhoods.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the cluster label of each point, numbered from 0 by increasing lowest core point index, -1 for the noise,
+ * in a (n_points,) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, int32_t, nb::ndim<1>> dbscan(
+    RefCloud<real_t> xyz, const real_t eps, const uint32_t min_points, const uint32_t min_cluster_size,
+    std::optional<nb::ndarray<const bool, nb::ndim<1>>> mask, const std::string& backend)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (n_points >= static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+    {
+        throw std::length_error("too many points to be labeled with int32 labels");
+    }
+    if (!(eps > real_t(0.0))) { throw std::invalid_argument("eps should be > 0"); }
+    if (min_points == 0) { throw std::invalid_argument("min_points should be > 0"); }
+    if (mask && mask->size() != n_points) { throw std::invalid_argument("mask should hold one value per point"); }
+
+    int32_t*    labels = new int32_t[n_points];
+    nb::capsule owner_labels(labels, [](void* p) noexcept { delete[] (int32_t*)p; });
+    std::fill(labels, labels + n_points, int32_t(-1));
+
+    // The masked out points are removed from the point cloud, so they are not searched
+    std::vector<uint32_t> selected;
+    PointCloud<real_t>    masked;
+    if (mask)
+    {
+        const bool* mask_data = mask->data();
+        for (size_t i = 0; i < n_points; ++i)
+        {
+            if (mask_data[i]) { selected.push_back(static_cast<uint32_t>(i)); }
+        }
+        masked.resize(static_cast<Eigen::Index>(selected.size()), 3);
+        for (size_t s = 0; s < selected.size(); ++s) { masked.row(s) = xyz.row(selected[s]); }
+    }
+    RefCloud<real_t> cloud    = mask ? RefCloud<real_t>(masked) : xyz;
+    const size_t     n_search = static_cast<size_t>(cloud.rows());
+    auto             point_of = [&](const size_t s) { return mask ? size_t(selected[s]) : s; };
+    if (n_search == 0) { return nb::ndarray<nb::numpy, int32_t, nb::ndim<1>>(labels, {n_points}, owner_labels); }
+
+    constexpr uint32_t                 no_core   = std::numeric_limits<uint32_t>::max();
+    const real_t                       sq_eps    = eps * eps;
+    const std::array<real_t, 3>        weights   = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    std::vector<uint8_t>               core(n_search);
+    std::vector<std::atomic<uint32_t>> border_of(n_search);
+    ConcurrentUnionFind                clusters(n_search);
+
+    with_search_index(
+        cloud, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            tf::Task     counting = taskflow.for_each_index(
+                size_t(0), n_search, size_t(1),
+                [&](size_t i)
+                {
+                    CountResultSet<real_t> result_set(min_points, sq_eps);
+                    index.findNeighbors(result_set, cloud.row(i).data());
+                    core[i] = result_set.size() >= min_points;
+                    border_of[i].store(no_core, std::memory_order_relaxed);
+                },
+                tf::StaticPartitioner(0));
+            tf::Task merging = taskflow.for_each_index(
+                size_t(0), n_search, size_t(1),
+                [&](size_t i)
+                {
+                    if (!core[i]) return;
+                    const uint32_t i32     = static_cast<uint32_t>(i);
+                    auto           visitor = [&](const uint32_t j)
+                    {
+                        // Each pair of core points is seen from both sides, it is merged from the highest one
+                        if (core[j])
+                        {
+                            if (j < i32) { clusters.unite(i32, j); }
+                        }
+                        else
+                        {
+                            uint32_t current = border_of[j].load(std::memory_order_relaxed);
+                            while (i32 < current &&
+                                   !border_of[j].compare_exchange_weak(current, i32, std::memory_order_relaxed))
+                            {
+                            }
+                        }
+                        return true;
+                    };
+                    VisitResultSet<real_t, decltype(visitor)> result_set(visitor, sq_eps);
+                    index.findNeighbors(result_set, cloud.row(i).data());
+                },
+                tf::StaticPartitioner(0));
+            counting.precede(merging);
+            executor.run(taskflow).get();
+        });
+
+    // The root of a cluster is its lowest core point
+    std::vector<uint32_t> root(n_search, no_root);
+    for (size_t i = 0; i < n_search; ++i)
+    {
+        const uint32_t border = border_of[i].load(std::memory_order_relaxed);
+        if (core[i]) { root[i] = clusters.find(static_cast<uint32_t>(i)); }
+        else if (border != no_core) { root[i] = clusters.find(border); }
+    }
+    label_clusters(root, min_cluster_size, point_of, labels);
+
+    return nb::ndarray<nb::numpy, int32_t, nb::ndim<1>>(labels, {n_points}, owner_labels);
+}
+
+/**
+ * Segment a point cloud into smooth regions by parallel region growing over a neighborhood graph.
+ *
+ * Two neighbors belong to the same region if the angle between their (unoriented) normals is at most 'max_angle' and,
+ * if a feature is given, both have a feature of at least 'min_feature' and the difference of their features is at
+ * most 'max_feature_difference'. The regions are the connected components of the graph of these edges, computed with
+ * a concurrent union-find in parallel over the points, so they do not depend on a seed order. Points with a null or
+ * non finite normal (e.g. with too few neighbors to compute it) do not belong to any region.
+ *
+ * @param normals the normals of the points.
+ * @param nn the flattened neighbor indices.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'. The graph does not need to be symmetric.
+ * @param max_angle the maximum angle (in radians, in [0, pi/2]) between the normals of two neighbors of a region.
+ * @param feature optional [n_points] feature of the points, e.g. their planarity.
+ * @param min_feature the points with a lower feature do not belong to any region.
+ * @param max_feature_difference the maximum difference between the features of two neighbors of a region.
+ * @param min_region_size the regions with less points are labeled as noise.
+ * @return the region label of each point, numbered from 0 by increasing lowest point index, -1 for the points of no
+ * region, in a (n_points,) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, int32_t, nb::ndim<1>> region_growing(
+    RefCloud<real_t> normals, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+    nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr, const real_t max_angle,
+    std::optional<nb::ndarray<const real_t, nb::ndim<1>, nb::c_contig>> feature, const real_t min_feature,
+    const real_t max_feature_difference, const uint32_t min_region_size)
+{
+    const size_t n_points = static_cast<size_t>(normals.rows());
+    if (n_points >= static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+    {
+        throw std::length_error("too many points to be labeled with int32 labels");
+    }
+    if (nn_ptr.size() != n_points + 1) { throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers"); }
+    const uint32_t* nn_data     = nn.data();
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    for (uint32_t e = 0; e < nn_ptr_data[n_points]; ++e)
+    {
+        if (nn_data[e] >= n_points)
+        {
+            throw std::invalid_argument("neighbor indices should be lower than the number of points");
+        }
+    }
+    if (!(max_angle >= real_t(0.0) && max_angle <= real_t(1.5707963267948966)))
+    {
+        throw std::invalid_argument("max_angle should be in [0, pi/2]");
+    }
+    if (feature && feature->size() != n_points)
+    {
+        throw std::invalid_argument("feature should hold one value per point");
+    }
+
+    const real_t  cos_max_angle = std::cos(max_angle);
+    const real_t* feature_data  = feature ? feature->data() : nullptr;
+
+    // Null (e.g. too few neighbors) or NaN normals have no direction, they would merge any neighbor
+    auto in_region = [&](const size_t i)
+    {
+        const real_t norm = normals.row(i).norm();
+        return std::isfinite(norm) && norm > real_t(0.0) && (!feature_data || feature_data[i] >= min_feature);
+    };
+
+    ConcurrentUnionFind regions(n_points);
+    tf::Executor        executor;
+    tf::Taskflow        taskflow;
+    taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            if (!in_region(i)) return;
+            const real_t norm_i = normals.row(i).norm();
+            for (uint32_t e = nn_ptr_data[i]; e < nn_ptr_data[i + 1]; ++e)
+            {
+                const uint32_t j = nn_data[e];
+                if (j == i || !in_region(j)) continue;
+                const real_t cos_angle = std::abs(normals.row(i).dot(normals.row(j)));
+                if (!(cos_angle >= cos_max_angle * norm_i * normals.row(j).norm())) continue;
+                if (feature_data && !(std::abs(feature_data[i] - feature_data[j]) <= max_feature_difference)) continue;
+                regions.unite(static_cast<uint32_t>(i), j);
+            }
+        },
+        tf::StaticPartitioner(0));
+    executor.run(taskflow).get();
+
+    int32_t*    labels = new int32_t[n_points];
+    nb::capsule owner_labels(labels, [](void* p) noexcept { delete[] (int32_t*)p; });
+    std::fill(labels, labels + n_points, int32_t(-1));
+
+    // The root of a region is its lowest point
+    std::vector<uint32_t> root(n_points, no_root);
+    for (size_t i = 0; i < n_points; ++i)
+    {
+        if (in_region(i)) { root[i] = regions.find(static_cast<uint32_t>(i)); }
+    }
+    label_clusters(root, min_region_size, [](const size_t i) { return i; }, labels);
+
+    return nb::ndarray<nb::numpy, int32_t, nb::ndim<1>>(labels, {n_points}, owner_labels);
+}
+
+}  // namespace pgeof
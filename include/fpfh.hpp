@@ -0,0 +1,263 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <nanoflann.hpp>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// Number of bins of each of the 3 angular features of a FPFH descriptor
+constexpr size_t fpfh_bins = 11;
+// Size of a FPFH descriptor
+constexpr size_t fpfh_size = 3 * fpfh_bins;
+
+/**
+ * Compute the Darboux frame angles (alpha, phi, theta) of a pair of oriented points, following Rusu et al. 2009 and
+ * the PCL / Open3D conventions: the source point is the one whose normal is the most aligned with the pair direction.
+ *
+ * @param p1 the first point.
+ * @param n1 the normal of the first point.
+ * @param p2 the second point.
+ * @param n2 the normal of the second point.
+ * @param features [3] the angles alpha in [-pi, pi], phi and theta in [-1, 1] (cosines), 0 for a degenerate pair.
+ */
+template <typename real_t>
+static inline void compute_pair_features(
+    const Vec3<real_t>& p1, const Vec3<real_t>& n1, const Vec3<real_t>& p2, const Vec3<real_t>& n2, real_t* features)
+{
+    features[0] = features[1] = features[2] = real_t(0.0);
+    Vec3<real_t> dp2p1 = p2 - p1;
+    const real_t norm  = dp2p1.norm();
+    if (norm == real_t(0.0)) { return; }
+
+    const real_t angle1 = n1.dot(dp2p1) / norm;
+    const real_t angle2 = n2.dot(dp2p1) / norm;
+    const bool   swap   = std::acos(std::abs(angle1)) > std::acos(std::abs(angle2));
+    const auto&  source = swap ? n2 : n1;
+    const auto&  target = swap ? n1 : n2;
+    if (swap) { dp2p1 = -dp2p1; }
+
+    Vec3<real_t> v      = dp2p1.cross(source);
+    const real_t v_norm = v.norm();
+    if (v_norm == real_t(0.0)) { return; }
+    v /= v_norm;
+    const Vec3<real_t> w = source.cross(v);
+
+    features[0] = std::atan2(w.dot(target), source.dot(target));
+    features[1] = v.dot(target);
+    features[2] = swap ? -angle2 : angle1;
+}
+
+/**
+ * Compute the FPFH descriptor (Fast Point Feature Histograms, Rusu et al. 2009) of each point of a point cloud, from
+ * oriented normals and the neighbors of each point.
+ *
+ * The simplified descriptors (SPFH) of every point are computed first, in parallel: the angles between the point and
+ * each of its neighbors are computed into a contiguous buffer, then binned in a branchless loop, and accumulated in 3
+ * histograms of 11 bins, normalized to 100. The FPFH descriptor of a point is then its SPFH plus the SPFH of its
+ * neighbors weighted by their inverse square distance, normalized to 100 per histogram, also in parallel.
+ *
+ * @param xyz the point cloud.
+ * @param normals the normals, aligned with xyz.
+ * @param nn the neighbor indices. Negative indices (padding of a radius search) and the point itself are ignored.
+ * @param row_ptr a functor giving the position of the first neighbor of a point in 'nn' ('row_ptr(n_points)' being
+ * the total number of neighbors)
+ * @return the descriptors in a (n_points, 33) nd::array.
+ */
+template <typename real_t, typename index_t, typename row_ptr_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fpfh_size)>> compute_fpfh(
+    RefCloud<real_t> xyz, RefCloud<real_t> normals, const index_t* nn, const row_ptr_t& row_ptr)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+
+    auto is_neighbor = [&](const size_t i, const size_t e)
+    {
+        if constexpr (std::is_signed_v<index_t>)
+        {
+            if (nn[e] < 0) return false;
+        }
+        return static_cast<size_t>(nn[e]) != i;
+    };
+
+    std::vector<real_t> spfh(n_points * fpfh_size, real_t(0.0));
+    real_t*             fpfh = new real_t[n_points * fpfh_size];
+    nb::capsule         owner_fpfh(fpfh, [](void* p) noexcept { delete[] (real_t*)p; });
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    tf::Task     simplified = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            // Angles of all the pairs (structure of arrays), then their bins
+            thread_local std::vector<real_t>   angles;
+            thread_local std::vector<uint32_t> bins;
+            angles.clear();
+            for (size_t e = row_ptr(i); e < row_ptr(i + 1); ++e)
+            {
+                if (!is_neighbor(i, e)) continue;
+                const size_t j = static_cast<size_t>(nn[e]);
+                real_t       features[3];
+                compute_pair_features<real_t>(xyz.row(i), normals.row(i), xyz.row(j), normals.row(j), features);
+                angles.insert(angles.end(), features, features + 3);
+            }
+            const size_t n_pairs = angles.size() / 3;
+            if (n_pairs == 0) return;
+
+            // Each angle is mapped to its bin, the (NaN proof) clamping keeping the upper bounds in the last bin
+            constexpr real_t pi       = real_t(3.14159265358979323846);
+            constexpr real_t n_bins   = real_t(fpfh_bins);
+            const real_t     scale[3] = {n_bins / (real_t(2.0) * pi), n_bins * real_t(0.5), n_bins * real_t(0.5)};
+            const real_t     shift[3] = {pi, real_t(1.0), real_t(1.0)};
+            bins.resize(angles.size());
+            for (size_t k = 0; k < angles.size(); ++k)
+            {
+                const size_t f   = k % 3;
+                const real_t bin = std::min(std::max(real_t(0.0), (angles[k] + shift[f]) * scale[f]), n_bins - 1);
+                bins[k]          = static_cast<uint32_t>(bin) + static_cast<uint32_t>(f * fpfh_bins);
+            }
+
+            real_t*      histogram = &spfh[i * fpfh_size];
+            const real_t increment = real_t(100.0) / real_t(n_pairs);
+            for (const uint32_t bin : bins) { histogram[bin] += increment; }
+        },
+        tf::StaticPartitioner(0));
+    tf::Task aggregated = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            real_t* descriptor = &fpfh[i * fpfh_size];
+            real_t  sum[3]     = {real_t(0.0), real_t(0.0), real_t(0.0)};
+            std::fill(descriptor, descriptor + fpfh_size, real_t(0.0));
+            for (size_t e = row_ptr(i); e < row_ptr(i + 1); ++e)
+            {
+                if (!is_neighbor(i, e)) continue;
+                const size_t j       = static_cast<size_t>(nn[e]);
+                const real_t sq_dist = (xyz.row(j) - xyz.row(i)).squaredNorm();
+                if (sq_dist == real_t(0.0)) continue;
+                const real_t  weight   = real_t(1.0) / sq_dist;
+                const real_t* neighbor = &spfh[j * fpfh_size];
+                for (size_t b = 0; b < fpfh_size; ++b)
+                {
+                    const real_t value = neighbor[b] * weight;
+                    descriptor[b] += value;
+                    sum[b / fpfh_bins] += value;
+                }
+            }
+            for (size_t f = 0; f < 3; ++f)
+            {
+                if (sum[f] != real_t(0.0)) { sum[f] = real_t(100.0) / sum[f]; }
+            }
+            const real_t* own = &spfh[i * fpfh_size];
+            for (size_t b = 0; b < fpfh_size; ++b) { descriptor[b] = descriptor[b] * sum[b / fpfh_bins] + own[b]; }
+        },
+        tf::StaticPartitioner(0));
+    simplified.precede(aggregated);
+    executor.run(taskflow).get();
+
+    const size_t shape[2] = {n_points, fpfh_size};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fpfh_size)>>(
+        fpfh, 2, shape, owner_fpfh);
+}
+
+/**
+ * Compute the FPFH descriptors of a point cloud from neighbors given in CSR format, see compute_fpfh.
+ *
+ * @param xyz the point cloud.
+ * @param normals the normals, aligned with xyz.
+ * @param nn the flattened neighbor indices.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'.
+ * @return the descriptors in a (n_points, 33) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fpfh_size)>> compute_fpfh_csr(
+    RefCloud<real_t> xyz, RefCloud<real_t> normals, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+    nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (normals.rows() != xyz.rows()) { throw std::invalid_argument("normals should be aligned with xyz"); }
+    if (nn_ptr.size() != n_points + 1) { throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers"); }
+    const uint32_t* nn_data     = nn.data();
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    for (uint32_t e = 0; e < nn_ptr_data[n_points]; ++e)
+    {
+        if (nn_data[e] >= n_points)
+        {
+            throw std::invalid_argument("neighbor indices should be lower than the number of points");
+        }
+    }
+    return compute_fpfh<real_t, uint32_t>(
+        xyz, normals, nn_data, [nn_ptr_data](const size_t i) { return static_cast<size_t>(nn_ptr_data[i]); });
+}
+
+/**
+ * Compute the FPFH descriptors of a point cloud from the neighbors within a radius of each point, see compute_fpfh.
+ * The neighbors are searched once, in parallel, and kept for both stages of the computation.
+ *
+ * @param xyz the point cloud.
+ * @param normals the normals, aligned with xyz.
+ * @param search_radius the search radius.
+ * @param max_knn the maximum number of neighbors to fetch inside the radius. The central point is included.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the descriptors in a (n_points, 33) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fpfh_size)>> compute_fpfh_radius(
+    RefCloud<real_t> xyz, RefCloud<real_t> normals, const real_t search_radius, const uint32_t max_knn,
+    const std::string& backend)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (normals.rows() != xyz.rows()) { throw std::invalid_argument("normals should be aligned with xyz"); }
+    if (max_knn > n_points)
+    {
+        throw std::invalid_argument("max knn size is greater than the data point cloud size");
+    }
+
+    const real_t                sq_search_radius = search_radius * search_radius;
+    const std::array<real_t, 3> weights          = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    std::vector<int32_t>        indices(n_points * max_knn, -1);
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    thread_local std::vector<real_t> dist_buffer;
+                    dist_buffer.resize(max_knn);
+                    nanoflann::RKNNResultSet<real_t, int32_t, uint32_t> result_set(max_knn, sq_search_radius);
+                    result_set.init(&indices[point_id * max_knn], dist_buffer.data());
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    return compute_fpfh<real_t, int32_t>(
+        xyz, normals, indices.data(), [max_knn](const size_t i) { return i * static_cast<size_t>(max_knn); });
+}
+
+}  // namespace pgeof
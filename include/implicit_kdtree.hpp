@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <utility>
+#include <vector>
+
+#include "pca.hpp"
+
+namespace pgeof
+{
+
+/**
+ * A pointer-free KD-tree over a 3D point cloud.
+ *
+ * The tree is complete: every leaf lies at the same depth and each node splits its points in two halves (up to one
+ * point) at the median of its widest dimension. The nodes are thus implicitly indexed in breadth-first order (the
+ * children of node 'i' being '2i+1' and '2i+2'), only their split dimension and value are stored in flat arrays. The
+ * points are copied and permuted into leaf order, so each leaf is a contiguous slice of 'points_' and a search
+ * streams through memory instead of chasing node pointers and gathering points from the original cloud.
+ *
+ * It exposes the nanoflann findNeighbors interface, so it is searched with the same result sets as a nanoflann index.
+ * It holds a copy of the point cloud: its memory footprint is 3 coordinates and 1 index per point. The copy may be
+ * scaled along each axis, queries being scaled the same way, to search with an anisotropic metric.
+ */
+template <typename real_t>
+class ImplicitKDTree
+{
+   public:
+    /**
+     * Build the tree, level by level, the nodes of a level being split in parallel.
+     *
+     * @param data the point cloud
+     * @param leaf_max_size the maximum number of points in a leaf
+     * @param scale the scale factor of each axis, applied to the points and to the queries
+     */
+    ImplicitKDTree(
+        RefCloud<real_t> data, const size_t leaf_max_size = 10,
+        const std::array<real_t, 3>& scale = {real_t(1.0), real_t(1.0), real_t(1.0)})
+        : scale_(scale)
+    {
+        const size_t n_points = static_cast<size_t>(data.rows());
+        if (n_points > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::length_error("the implicit KD-tree is limited to 2^32 points");
+        }
+        if (leaf_max_size < 2) { throw std::invalid_argument("leaf_max_size should be >= 2"); }
+
+        size_t n_levels = 0;
+        for (n_leaves_ = 1; n_leaves_ * leaf_max_size < n_points; n_leaves_ *= 2) { ++n_levels; }
+        split_dim_.resize(n_leaves_ - 1);
+        split_value_.resize(n_leaves_ - 1);
+        ids_.resize(n_points);
+        std::iota(ids_.begin(), ids_.end(), uint32_t(0));
+
+        // Boundaries of the node ranges (in ids_) of the current level, they end up being the leaf boundaries
+        leaf_begin_ = {0, static_cast<uint32_t>(n_points)};
+        std::vector<uint32_t> next_begin;
+
+        tf::Executor executor;
+        tf::Taskflow taskflow;
+        for (size_t level = 0; level < n_levels; ++level)
+        {
+            const size_t n_nodes = leaf_begin_.size() - 1;
+            next_begin.resize(2 * n_nodes + 1);
+            next_begin[2 * n_nodes] = static_cast<uint32_t>(n_points);
+            taskflow.for_each_index(
+                size_t(0), n_nodes, size_t(1),
+                [&](size_t i_node) { split_node(data, n_nodes - 1 + i_node, i_node, next_begin); },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+            taskflow.clear();
+            std::swap(leaf_begin_, next_begin);
+        }
+
+        points_.resize(3 * n_points);
+        taskflow.for_each_index(
+            size_t(0), n_points, size_t(1),
+            [&](size_t i)
+            {
+                for (size_t d = 0; d < 3; ++d) { points_[3 * i + d] = data(ids_[i], d) * scale_[d]; }
+            },
+            tf::StaticPartitioner(0));
+        executor.run(taskflow).get();
+    }
+
+    /**
+     * Find the neighbors of a query point, following the nanoflann index interface.
+     *
+     * @param result_set the result set, already initialized. Its type is the one of a nanoflann search.
+     * @param query_point the 3 coordinates of the query point
+     * @return true if the result set is full
+     */
+    template <typename ResultSet>
+    bool findNeighbors(ResultSet& result_set, const real_t* query_point) const
+    {
+        const real_t scaled[3] = {query_point[0] * scale_[0], query_point[1] * scale_[1], query_point[2] * scale_[2]};
+        real_t       dists[3]  = {real_t(0.0), real_t(0.0), real_t(0.0)};
+        search_level(result_set, scaled, 0, real_t(0.0), dists);
+        return result_set.full();
+    }
+
+   private:
+    // Split the point range of a node at the median of its widest dimension
+    void split_node(RefCloud<real_t> data, const size_t node, const size_t i_node, std::vector<uint32_t>& next_begin)
+    {
+        const uint32_t begin = leaf_begin_[i_node];
+        const uint32_t end   = leaf_begin_[i_node + 1];
+        const uint32_t mid   = begin + (end - begin) / 2;
+
+        real_t low[3], high[3];
+        for (size_t d = 0; d < 3; ++d)
+        {
+            low[d]  = std::numeric_limits<real_t>::max();
+            high[d] = std::numeric_limits<real_t>::lowest();
+        }
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            for (size_t d = 0; d < 3; ++d)
+            {
+                low[d]  = std::min(low[d], data(ids_[i], d) * scale_[d]);
+                high[d] = std::max(high[d], data(ids_[i], d) * scale_[d]);
+            }
+        }
+        uint8_t dim = 0;
+        for (uint8_t d = 1; d < 3; ++d)
+        {
+            if (high[d] - low[d] > high[dim] - low[dim]) { dim = d; }
+        }
+
+        // Points of the left child are <= split value, points of the right child are >= split value
+        std::nth_element(
+            ids_.begin() + begin, ids_.begin() + mid, ids_.begin() + end,
+            [&](const uint32_t a, const uint32_t b) { return data(a, dim) < data(b, dim); });
+        split_dim_[node]           = dim;
+        split_value_[node]         = mid < end ? data(ids_[mid], dim) * scale_[dim] : real_t(0.0);
+        next_begin[2 * i_node]     = begin;
+        next_begin[2 * i_node + 1] = mid;
+    }
+
+    /**
+     * Search a node, following nanoflann incremental distance to the node cell.
+     *
+     * @param mindist the square distance between the query and the node cell
+     * @param dists [3] the contribution of each dimension to mindist
+     * @return false if the result set stopped the search
+     */
+    template <typename ResultSet>
+    bool search_level(
+        ResultSet& result_set, const real_t* query_point, const size_t node, real_t mindist, real_t* dists) const
+    {
+        const size_t n_inner = n_leaves_ - 1;
+        if (node >= n_inner)
+        {
+            const size_t leaf = node - n_inner;
+            for (uint32_t i = leaf_begin_[leaf]; i < leaf_begin_[leaf + 1]; ++i)
+            {
+                const real_t* point = &points_[3 * static_cast<size_t>(i)];
+                const real_t  dx    = query_point[0] - point[0];
+                const real_t  dy    = query_point[1] - point[1];
+                const real_t  dz    = query_point[2] - point[2];
+                const real_t  dist  = dx * dx + dy * dy + dz * dz;
+                if (dist < result_set.worstDist())
+                {
+                    if (!result_set.addPoint(dist, ids_[i])) { return false; }
+                }
+            }
+            return true;
+        }
+
+        // Visit the child holding the query first, the other one only if its cell is within the worst distance
+        const uint8_t dim   = split_dim_[node];
+        const real_t  diff  = query_point[dim] - split_value_[node];
+        const size_t  first = diff < real_t(0.0) ? 2 * node + 1 : 2 * node + 2;
+        if (!search_level(result_set, query_point, first, mindist, dists)) { return false; }
+
+        const real_t cut_dist = diff * diff;
+        const real_t saved    = dists[dim];
+        mindist               = mindist + cut_dist - saved;
+        dists[dim]            = cut_dist;
+        if (mindist <= result_set.worstDist())
+        {
+            const size_t second = diff < real_t(0.0) ? 2 * node + 2 : 2 * node + 1;
+            if (!search_level(result_set, query_point, second, mindist, dists)) { return false; }
+        }
+        dists[dim] = saved;
+        return true;
+    }
+
+    std::array<real_t, 3> scale_;
+    size_t                n_leaves_;
+    std::vector<uint8_t>  split_dim_;
+    std::vector<real_t>   split_value_;
+    std::vector<uint32_t> leaf_begin_;
+    std::vector<uint32_t> ids_;
+    std::vector<real_t>   points_;
+};
+
+}  // namespace pgeof
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/tuple.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/algorithm/scan.hpp>
+#include <taskflow/taskflow.hpp>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// Kind of graph built from a list of (directed) nearest neighbors
+typedef enum EKnnGraphMode
+{
+    Directed = 0,  // j is a neighbor of i if j is in the neighbors of i
+    Symmetric,  // j is a neighbor of i if j is in the neighbors of i or i is in the neighbors of j
+    Mutual  // j is a neighbor of i if j is in the neighbors of i and i is in the neighbors of j
+} EKnnGraphMode;
+
+/**
+ * Convert the name of a kNN graph mode into a EKnnGraphMode.
+ *
+ * @param mode one of 'directed', 'symmetric' or 'mutual'
+ * @return the corresponding EKnnGraphMode
+ */
+static EKnnGraphMode knn_graph_mode_from_string(const std::string& mode)
+{
+    if (mode == "directed") { return EKnnGraphMode::Directed; }
+    if (mode == "symmetric") { return EKnnGraphMode::Symmetric; }
+    if (mode == "mutual") { return EKnnGraphMode::Mutual; }
+    throw std::invalid_argument("mode should be one of 'directed', 'symmetric' or 'mutual'");
+}
+
+/**
+ * Build a directed, symmetric or mutual graph from a list of nearest neighbors, pruning the edges longer than a given
+ * distance.
+ *
+ * The reversed edges are gathered with atomic counters and a parallel prefix sum, each node then merges (union or
+ * intersection) its outgoing and incoming edges. Each step is parallel over the nodes.
+ *
+ * @param n_points the number of nodes. Every neighbor index should be lower than n_points.
+ * @param nn the neighbor indices. Negative indices (padding of a radius search) are ignored.
+ * @param row_ptr a functor giving the position of the first neighbor of a node in 'nn' ('row_ptr(n_points)' being
+ * the total number of neighbors)
+ * @param sq_dist the square distances aligned with 'nn', or nullptr if not available.
+ * @param mode the kind of graph to build.
+ * @param max_distance the edges longer than this distance are removed. It requires the square distances.
+ * @return a tuple of nd::array: 'nn' the flattened indices of the neighbors, 'nn_ptr' [n_points+1] pointers wrt 'nn'
+ * and the 'square_distances' of the edges, aligned with 'nn' (None if 'sq_dist' is nullptr). Neighbors are sorted by
+ * increasing distance when the distances are known, by increasing index otherwise.
+ */
+template <typename real_t, typename index_t, typename row_ptr_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>>>
+    build_knn_graph(
+        const size_t n_points, const index_t* nn, const row_ptr_t& row_ptr, const real_t* sq_dist,
+        const EKnnGraphMode mode, const real_t max_distance)
+{
+    using edge_t = std::pair<uint32_t, real_t>;
+
+    const bool   has_dist = sq_dist != nullptr;
+    const bool   prune    = max_distance < std::numeric_limits<real_t>::infinity();
+    const real_t max_sq   = max_distance * max_distance;
+    if (prune && !has_dist) { throw std::invalid_argument("pruning by distance requires the square distances"); }
+    if (n_points >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many points to be indexed with uint32 indices");
+    }
+
+    // An edge is kept if it is a valid neighbor within the pruning distance
+    auto is_kept = [&](const size_t e)
+    {
+        if constexpr (std::is_signed_v<index_t>)
+        {
+            if (nn[e] < 0) return false;
+        }
+        return !prune || sq_dist[e] <= max_sq;
+    };
+
+    std::atomic<bool> out_of_range{false};
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+
+    // Reversed edges, in CSR format. Only needed for the symmetric and mutual graphs
+    std::vector<uint32_t> in_ptr;
+    std::vector<uint32_t> in_nn;
+    std::vector<real_t>   in_dist;
+    if (mode != EKnnGraphMode::Directed)
+    {
+        std::vector<std::atomic<uint32_t>> in_count(n_points);
+        taskflow.for_each_index(
+            size_t(0), n_points, size_t(1),
+            [&](size_t i)
+            {
+                for (size_t e = row_ptr(i); e < row_ptr(i + 1); ++e)
+                {
+                    if (!is_kept(e)) continue;
+                    const size_t j = static_cast<size_t>(nn[e]);
+                    if (j >= n_points)
+                    {
+                        out_of_range = true;
+                        continue;
+                    }
+                    in_count[j].fetch_add(1, std::memory_order_relaxed);
+                }
+            },
+            tf::StaticPartitioner(0));
+        executor.run(taskflow).get();
+        if (out_of_range) { throw std::invalid_argument("neighbor indices should be lower than the number of points"); }
+
+        in_ptr.resize(n_points + 1);
+        in_ptr[0] = 0;
+        size_t n_in = 0;
+        for (size_t i = 0; i < n_points; ++i) { n_in += in_count[i].load(std::memory_order_relaxed); }
+        if (n_in > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::length_error("too many edges to be indexed with uint32 pointers");
+        }
+        in_nn.resize(n_in);
+        if (has_dist) { in_dist.resize(n_in); }
+
+        taskflow.clear();
+        tf::Task count = taskflow.for_each_index(
+            size_t(0), n_points, size_t(1),
+            [&](size_t i) { in_ptr[i + 1] = in_count[i].exchange(0, std::memory_order_relaxed); },
+            tf::StaticPartitioner(0));
+        tf::Task scan =
+            taskflow.inclusive_scan(in_ptr.begin() + 1, in_ptr.end(), in_ptr.begin() + 1, std::plus<uint32_t>());
+        // The counters are reused as insertion cursors
+        tf::Task fill = taskflow.for_each_index(
+            size_t(0), n_points, size_t(1),
+            [&](size_t i)
+            {
+                for (size_t e = row_ptr(i); e < row_ptr(i + 1); ++e)
+                {
+                    if (!is_kept(e)) continue;
+                    const size_t   j   = static_cast<size_t>(nn[e]);
+                    const uint32_t pos = in_ptr[j] + in_count[j].fetch_add(1, std::memory_order_relaxed);
+                    in_nn[pos]         = static_cast<uint32_t>(i);
+                    if (has_dist) { in_dist[pos] = sq_dist[e]; }
+                }
+            },
+            tf::StaticPartitioner(0));
+        count.precede(scan);
+        scan.precede(fill);
+        executor.run(taskflow).get();
+    }
+
+    // Gather the edges of node i into 'edges', sorted as they are returned
+    auto merge_node = [&](const size_t i, std::vector<edge_t>& edges, std::vector<edge_t>& in_edges)
+    {
+        edges.clear();
+        for (size_t e = row_ptr(i); e < row_ptr(i + 1); ++e)
+        {
+            if (!is_kept(e)) continue;
+            const size_t j = static_cast<size_t>(nn[e]);
+            if (j >= n_points)
+            {
+                out_of_range = true;
+                continue;
+            }
+            edges.emplace_back(static_cast<uint32_t>(j), has_dist ? sq_dist[e] : real_t(0.0));
+        }
+        if (mode == EKnnGraphMode::Directed)
+        {
+            // Neighbors are kept in their original order, only sorted by index if there are no distances
+            if (!has_dist) { std::sort(edges.begin(), edges.end()); }
+            return;
+        }
+
+        in_edges.clear();
+        for (uint32_t e = in_ptr[i]; e < in_ptr[i + 1]; ++e)
+        {
+            in_edges.emplace_back(in_nn[e], has_dist ? in_dist[e] : real_t(0.0));
+        }
+
+        auto by_index   = [](const edge_t& a, const edge_t& b) { return a.first < b.first; };
+        auto same_index = [](const edge_t& a, const edge_t& b) { return a.first == b.first; };
+        std::sort(edges.begin(), edges.end(), by_index);
+        edges.erase(std::unique(edges.begin(), edges.end(), same_index), edges.end());
+        std::sort(in_edges.begin(), in_edges.end(), by_index);
+        in_edges.erase(std::unique(in_edges.begin(), in_edges.end(), same_index), in_edges.end());
+
+        if (mode == EKnnGraphMode::Symmetric)
+        {
+            // Stable merge: an edge present in both lists keeps its outgoing version
+            const size_t n_out = edges.size();
+            edges.insert(edges.end(), in_edges.begin(), in_edges.end());
+            std::inplace_merge(edges.begin(), edges.begin() + n_out, edges.end(), by_index);
+            edges.erase(std::unique(edges.begin(), edges.end(), same_index), edges.end());
+        }
+        else
+        {
+            // In place intersection, the write position never overtakes the read position
+            size_t n_kept = 0;
+            size_t e_in   = 0;
+            for (size_t e = 0; e < edges.size(); ++e)
+            {
+                while (e_in < in_edges.size() && in_edges[e_in].first < edges[e].first) { ++e_in; }
+                if (e_in < in_edges.size() && in_edges[e_in].first == edges[e].first) { edges[n_kept++] = edges[e]; }
+            }
+            edges.resize(n_kept);
+        }
+        if (has_dist)
+        {
+            std::sort(
+                edges.begin(), edges.end(),
+                [](const edge_t& a, const edge_t& b)
+                { return a.second < b.second || (a.second == b.second && a.first < b.first); });
+        }
+    };
+
+    uint32_t*   out_ptr = new uint32_t[n_points + 1];
+    nb::capsule owner_out_ptr(out_ptr, [](void* p) noexcept { delete[] (uint32_t*)p; });
+    out_ptr[0] = 0;
+
+    // First pass: count the edges of each node
+    taskflow.clear();
+    taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            thread_local std::vector<edge_t> edges;
+            thread_local std::vector<edge_t> in_edges;
+            merge_node(i, edges, in_edges);
+            out_ptr[i + 1] = static_cast<uint32_t>(edges.size());
+        },
+        tf::StaticPartitioner(0));
+    executor.run(taskflow).get();
+    if (out_of_range) { throw std::invalid_argument("neighbor indices should be lower than the number of points"); }
+
+    size_t n_edges = 0;
+    for (size_t i = 0; i < n_points; ++i) { n_edges += out_ptr[i + 1]; }
+    if (n_edges > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many edges to be indexed with uint32 pointers");
+    }
+
+    uint32_t*   out_nn = new uint32_t[n_edges];
+    nb::capsule owner_out_nn(out_nn, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    real_t*     out_dist = nullptr;
+    nb::capsule owner_out_dist;
+    if (has_dist)
+    {
+        out_dist       = new real_t[n_edges];
+        owner_out_dist = nb::capsule(out_dist, [](void* p) noexcept { delete[] (real_t*)p; });
+    }
+
+    // Second pass: write the edges of each node at their final location
+    taskflow.clear();
+    tf::Task scan = taskflow.inclusive_scan(out_ptr + 1, out_ptr + n_points + 1, out_ptr + 1, std::plus<uint32_t>());
+    tf::Task fill = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            thread_local std::vector<edge_t> edges;
+            thread_local std::vector<edge_t> in_edges;
+            merge_node(i, edges, in_edges);
+            for (size_t e = 0; e < edges.size(); ++e)
+            {
+                out_nn[out_ptr[i] + e] = edges[e].first;
+                if (has_dist) { out_dist[out_ptr[i] + e] = edges[e].second; }
+            }
+        },
+        tf::StaticPartitioner(0));
+    scan.precede(fill);
+    executor.run(taskflow).get();
+
+    const size_t shape_nn[1]     = {n_edges};
+    const size_t shape_nn_ptr[1] = {n_points + 1};
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>> distances;
+    if (has_dist) { distances = nb::ndarray<nb::numpy, real_t, nb::ndim<1>>(out_dist, 1, shape_nn, owner_out_dist); }
+    return {
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(out_nn, 1, shape_nn, owner_out_nn),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(out_ptr, 1, shape_nn_ptr, owner_out_ptr), distances};
+}
+
+/**
+ * Build a directed, symmetric or mutual graph from the (n_points, k) neighbors of a point cloud searched against
+ * itself (as returned by knn_search or radius_search), optionally pruning the edges by distance.
+ *
+ * @param nn [n_points, k] the neighbor indices. '-1' indices are ignored.
+ * @param sq_dist [n_points, k] the optional square distances between each point and its neighbors.
+ * @param mode one of 'directed', 'symmetric' or 'mutual'.
+ * @param max_distance the edges longer than this distance are removed. It requires the square distances.
+ * @return a tuple of nd::array, 'nn', 'nn_ptr' and the optional 'square_distances' of the graph in CSR format.
+ */
+template <typename real_t, typename index_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>>>
+    knn_graph(
+        nb::ndarray<const index_t, nb::ndim<2>, nb::c_contig>               nn,
+        std::optional<nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>> sq_dist, const std::string& mode,
+        const real_t max_distance)
+{
+    const size_t n_points = nn.shape(0);
+    const size_t knn      = nn.shape(1);
+    if (sq_dist && (sq_dist->shape(0) != n_points || sq_dist->shape(1) != knn))
+    {
+        throw std::invalid_argument("sq_dist should have the same shape as nn");
+    }
+    return build_knn_graph<real_t, index_t>(
+        n_points, nn.data(), [knn](const size_t i) { return i * knn; }, sq_dist ? sq_dist->data() : nullptr,
+        knn_graph_mode_from_string(mode), max_distance);
+}
+
+/**
+ * Build a directed, symmetric or mutual graph from the neighbors of a point cloud searched against itself, given in
+ * CSR format, optionally pruning the edges by distance.
+ *
+ * @param nn the flattened neighbor indices.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'.
+ * @param sq_dist the optional square distances aligned with 'nn'.
+ * @param mode one of 'directed', 'symmetric' or 'mutual'.
+ * @param max_distance the edges longer than this distance are removed. It requires the square distances.
+ * @return a tuple of nd::array, 'nn', 'nn_ptr' and the optional 'square_distances' of the graph in CSR format.
+ */
+template <typename real_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<1>>>>
+    knn_graph_csr(
+        nb::ndarray<const uint32_t, nb::ndim<1>> nn, nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr,
+        std::optional<nb::ndarray<const real_t, nb::ndim<1>>> sq_dist, const std::string& mode,
+        const real_t max_distance)
+{
+    if (nn_ptr.size() == 0) { throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers"); }
+    const size_t    n_points    = nn_ptr.size() - 1;
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    if (sq_dist && sq_dist->size() != nn.size()) { throw std::invalid_argument("sq_dist should be aligned with nn"); }
+    return build_knn_graph<real_t, uint32_t>(
+        n_points, nn.data(), [nn_ptr_data](const size_t i) { return static_cast<size_t>(nn_ptr_data[i]); },
+        sq_dist ? sq_dist->data() : nullptr, knn_graph_mode_from_string(mode), max_distance);
+}
+
+}  // namespace pgeof
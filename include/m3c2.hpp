@@ -0,0 +1,275 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/tuple.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <tuple>
+
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+/**
+ * A nanoflann result set accumulating the moments of the points found in a sphere, without storing them.
+ */
+template <typename real_t>
+class MomentsResultSet
+{
+   public:
+    MomentsResultSet(RefCloud<real_t> xyz, PointMoments<real_t>& moments, const real_t sq_radius)
+        : xyz_(xyz), moments_(moments), sq_radius_(sq_radius)
+    {
+    }
+
+    bool   full() const { return true; }
+    real_t worstDist() const { return sq_radius_; }
+
+    template <typename index_t>
+    bool addPoint(const real_t, const index_t index)
+    {
+        moments_.add(xyz_.row(static_cast<Eigen::Index>(index)));
+        return true;
+    }
+
+   private:
+    RefCloud<real_t>      xyz_;
+    PointMoments<real_t>& moments_;
+    const real_t          sq_radius_;
+};
+
+/**
+ * A nanoflann result set accumulating the positions along a cylinder axis of the points lying in one segment of the
+ * cylinder, without storing them. The segment is enclosed in the searched sphere, centered on the segment center.
+ */
+template <typename real_t>
+class CylinderResultSet
+{
+   public:
+    CylinderResultSet(
+        RefCloud<real_t> xyz, const Vec3<real_t>& origin, const Vec3<real_t>& axis, const real_t sq_cylinder_radius,
+        const real_t t_begin, const real_t t_end, const bool closed, const real_t sq_radius)
+        : xyz_(xyz),
+          origin_(origin),
+          axis_(axis),
+          sq_cylinder_radius_(sq_cylinder_radius),
+          t_begin_(t_begin),
+          t_end_(t_end),
+          closed_(closed),
+          sq_radius_(sq_radius)
+    {
+    }
+
+    bool   full() const { return true; }
+    real_t worstDist() const { return sq_radius_; }
+
+    template <typename index_t>
+    bool addPoint(const real_t, const index_t index)
+    {
+        const Vec3<real_t> offset = xyz_.row(static_cast<Eigen::Index>(index)) - origin_;
+        const real_t       t      = offset.dot(axis_);
+        // Segments are half-open, so that a point is counted in one segment only, except for the last one
+        if (t < t_begin_ || t > t_end_ || (t == t_end_ && !closed_)) { return true; }
+        if (offset.squaredNorm() - t * t > sq_cylinder_radius_) { return true; }
+        ++count;
+        sum += t;
+        sum_sq += double(t) * double(t);
+        return true;
+    }
+
+    size_t count  = 0;
+    double sum    = 0.0;
+    double sum_sq = 0.0;
+
+   private:
+    RefCloud<real_t>   xyz_;
+    const Vec3<real_t> origin_;
+    const Vec3<real_t> axis_;
+    const real_t       sq_cylinder_radius_;
+    const real_t       t_begin_;
+    const real_t       t_end_;
+    const bool         closed_;
+    const real_t       sq_radius_;
+};
+
+/**
+ * Compute the number, mean and sample standard deviation of the positions along the axis of the points of a cylinder.
+ *
+ * A long cylinder does not fit well in a sphere, so it is cut into segments about as long as its diameter, each
+ * segment being searched with its enclosing sphere.
+ *
+ * @param index the index of the point cloud, exposing findNeighbors (see with_search_index).
+ * @param xyz the point cloud.
+ * @param origin the center of the cylinder.
+ * @param axis the unit axis of the cylinder.
+ * @param cylinder_radius the radius of the cylinder.
+ * @param max_depth the half length of the cylinder.
+ * @return the number of points, the mean and the standard deviation of their positions along the axis.
+ */
+template <typename real_t, typename index_t>
+static std::tuple<size_t, real_t, real_t> cylinder_statistics(
+    const index_t& index, RefCloud<real_t> xyz, const Vec3<real_t>& origin, const Vec3<real_t>& axis,
+    const real_t cylinder_radius, const real_t max_depth)
+{
+    const size_t n_segments    = static_cast<size_t>(std::max(real_t(1.0), std::ceil(max_depth / cylinder_radius)));
+    const real_t half_length   = max_depth / real_t(n_segments);
+    const real_t sq_cyl_radius = cylinder_radius * cylinder_radius;
+    // The sphere is slightly inflated as nanoflann only reports the points strictly inside it
+    const real_t sq_radius = (sq_cyl_radius + half_length * half_length) * real_t(1.0001);
+
+    size_t count  = 0;
+    double sum    = 0.0;
+    double sum_sq = 0.0;
+    // Each boundary is computed once, as the end of a segment and the start of the next one, so that a point lying on
+    // it is counted exactly once
+    real_t t_begin = -max_depth;
+    for (size_t i_segment = 0; i_segment < n_segments; ++i_segment)
+    {
+        const bool         last   = i_segment + 1 == n_segments;
+        const real_t       t_end  = last ? max_depth : -max_depth + real_t(2 * (i_segment + 1)) * half_length;
+        const Vec3<real_t> center = origin + (t_begin + half_length) * axis;
+        CylinderResultSet<real_t> result_set(xyz, origin, axis, sq_cyl_radius, t_begin, t_end, last, sq_radius);
+        index.findNeighbors(result_set, center.data());
+        count += result_set.count;
+        sum += result_set.sum;
+        sum_sq += result_set.sum_sq;
+        t_begin = t_end;
+    }
+
+    const real_t nan = std::numeric_limits<real_t>::quiet_NaN();
+    if (count == 0) { return {0, nan, nan}; }
+    const double mean = sum / double(count);
+    if (count == 1) { return {1, static_cast<real_t>(mean), nan}; }
+    const double variance = std::max(0.0, (sum_sq - double(count) * mean * mean) / double(count - 1));
+    return {count, static_cast<real_t>(mean), static_cast<real_t>(std::sqrt(variance))};
+}
+
+/**
+ * Compute the M3C2 distance (Multiscale Model to Model Cloud Comparison, Lague et al. 2013) between two epochs of a
+ * point cloud, at a set of core points.
+ *
+ * For each core point, the normal is the third eigenvector of the PCA of the first epoch points within
+ * 'normal_radius', oriented towards +z. The points of each epoch lying in the cylinder of radius 'cylinder_radius' and
+ * half length 'max_depth' along this normal are projected on its axis. The distance is the difference between the
+ * mean positions of the second and first epochs, and the level of detection at 95% is
+ * 1.96 * (sqrt(std_1^2 / n_1 + std_2^2 / n_2) + registration_error). Core points are processed in parallel.
+ *
+ * @param epoch1 the reference point cloud.
+ * @param epoch2 the compared point cloud.
+ * @param core_points the points where the distance is computed, e.g. a subsampling of epoch1.
+ * @param normal_radius the radius of the normal computation.
+ * @param cylinder_radius the radius of the projection cylinder.
+ * @param max_depth the half length of the projection cylinder.
+ * @param registration_error the registration error between the two epochs, added to the level of detection.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return a tuple of arrays: the distances [n_core], the levels of detection [n_core], the normals [n_core, 3] and the
+ * number of points of each epoch in each cylinder [n_core, 2]. Distances are NaN if a cylinder is empty in one of the
+ * epochs, levels of detection are NaN if it holds less than 2 points, normals are NaN if the normal neighborhood holds
+ * less than 3 points.
+ */
+template <typename real_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, real_t, nb::ndim<1>>, nb::ndarray<nb::numpy, real_t, nb::ndim<1>>,
+    nb::ndarray<nb::numpy, real_t, nb::ndim<2>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>>
+    compute_m3c2(
+        RefCloud<real_t> epoch1, RefCloud<real_t> epoch2, RefCloud<real_t> core_points, const real_t normal_radius,
+        const real_t cylinder_radius, const real_t max_depth, const real_t registration_error,
+        const std::string& backend)
+{
+    if (!(normal_radius > real_t(0.0)) || !(cylinder_radius > real_t(0.0)) || !(max_depth > real_t(0.0)))
+    {
+        throw std::invalid_argument("normal_radius, cylinder_radius and max_depth should be > 0");
+    }
+    if (!(registration_error >= real_t(0.0)))
+    {
+        throw std::invalid_argument("registration_error should be >= 0");
+    }
+    if (epoch1.rows() == 0 || epoch2.rows() == 0) { throw std::invalid_argument("epochs should not be empty"); }
+
+    const size_t n_points  = static_cast<size_t>(core_points.rows());
+    real_t*      distances = new real_t[n_points];
+    real_t*      lod       = new real_t[n_points];
+    real_t*      normals   = new real_t[3 * n_points];
+    uint32_t*    counts    = new uint32_t[2 * n_points];
+    nb::capsule  owner_distances(distances, [](void* p) noexcept { delete[] (real_t*)p; });
+    nb::capsule  owner_lod(lod, [](void* p) noexcept { delete[] (real_t*)p; });
+    nb::capsule  owner_normals(normals, [](void* p) noexcept { delete[] (real_t*)p; });
+    nb::capsule  owner_counts(counts, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    const real_t                nan              = std::numeric_limits<real_t>::quiet_NaN();
+    const real_t                sq_normal_radius = normal_radius * normal_radius;
+    const std::array<real_t, 3> weights          = {real_t(1.0), real_t(1.0), real_t(1.0)};
+
+    with_search_index(
+        epoch1, backend, weights,
+        [&](const auto& index1)
+        {
+            with_search_index(
+                epoch2, backend, weights,
+                [&](const auto& index2)
+                {
+                    tf::Executor executor;
+                    tf::Taskflow taskflow;
+                    taskflow.for_each_index(
+                        size_t(0), n_points, size_t(1),
+                        [&](size_t point_id)
+                        {
+                            const Vec3<real_t>   core = core_points.row(point_id);
+                            PointMoments<real_t> moments(core);
+                            MomentsResultSet<real_t> normal_set(epoch1, moments, sq_normal_radius);
+                            index1.findNeighbors(normal_set, core.data());
+
+                            distances[point_id]      = nan;
+                            lod[point_id]            = nan;
+                            counts[2 * point_id]     = 0;
+                            counts[2 * point_id + 1] = 0;
+                            if (moments.count < 3)
+                            {
+                                for (size_t d = 0; d < 3; ++d) { normals[3 * point_id + d] = nan; }
+                                return;
+                            }
+                            const Vec3<real_t> normal = pca_from_moments(moments).v2.normalized();
+                            for (size_t d = 0; d < 3; ++d) { normals[3 * point_id + d] = normal(d); }
+
+                            const auto [n1, mean1, std1] =
+                                cylinder_statistics(index1, epoch1, core, normal, cylinder_radius, max_depth);
+                            const auto [n2, mean2, std2] =
+                                cylinder_statistics(index2, epoch2, core, normal, cylinder_radius, max_depth);
+                            counts[2 * point_id]     = static_cast<uint32_t>(n1);
+                            counts[2 * point_id + 1] = static_cast<uint32_t>(n2);
+                            if (n1 == 0 || n2 == 0) { return; }
+                            distances[point_id] = mean2 - mean1;
+                            if (n1 < 2 || n2 < 2) { return; }
+                            lod[point_id] =
+                                real_t(1.96) * (std::sqrt(std1 * std1 / real_t(n1) + std2 * std2 / real_t(n2)) +
+                                                registration_error);
+                        },
+                        tf::StaticPartitioner(0));
+                    executor.run(taskflow).get();
+                });
+        });
+
+    const size_t shape_1d[1]      = {n_points};
+    const size_t shape_normals[2] = {n_points, 3};
+    const size_t shape_counts[2]  = {n_points, 2};
+    return {
+        nb::ndarray<nb::numpy, real_t, nb::ndim<1>>(distances, 1, shape_1d, owner_distances),
+        nb::ndarray<nb::numpy, real_t, nb::ndim<1>>(lod, 1, shape_1d, owner_lod),
+        nb::ndarray<nb::numpy, real_t, nb::ndim<2>>(normals, 2, shape_normals, owner_normals),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>(counts, 2, shape_counts, owner_counts)};
+}
+
+}  // namespace pgeof
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <nanoflann.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <vector>
+
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// Reductions of a per-point attribute over a neighborhood
+typedef enum EStatistic
+{
+    Mean = 0,
+    Std,  // population standard deviation
+    Min,
+    Max,
+    Median  // mean of the two middle values for an even number of neighbors
+} EStatistic;
+
+/**
+ * Convert the names of neighborhood statistics into EStatistic.
+ *
+ * @param statistics a list of 'mean', 'std', 'min', 'max' or 'median'
+ * @return the corresponding EStatistic
+ */
+static std::vector<EStatistic> statistics_from_strings(const std::vector<std::string>& statistics)
+{
+    if (statistics.empty()) { throw std::invalid_argument("statistics should not be empty"); }
+    std::vector<EStatistic> result;
+    for (const std::string& statistic : statistics)
+    {
+        if (statistic == "mean") { result.push_back(EStatistic::Mean); }
+        else if (statistic == "std") { result.push_back(EStatistic::Std); }
+        else if (statistic == "min") { result.push_back(EStatistic::Min); }
+        else if (statistic == "max") { result.push_back(EStatistic::Max); }
+        else if (statistic == "median") { result.push_back(EStatistic::Median); }
+        else { throw std::invalid_argument("statistics should be among 'mean', 'std', 'min', 'max' and 'median'"); }
+    }
+    return result;
+}
+
+/**
+ * Compute statistics of the attributes of a set of points (typically a neighborhood).
+ *
+ * The attributes of the points are gathered once, channel by channel, into a contiguous buffer, on which every
+ * statistic of a channel is then computed.
+ *
+ * @param attributes [n_points, n_channels] the attributes of the point cloud, in row-major order.
+ * @param n_channels the number of attributes of each point.
+ * @param k_nn the number of points in the subset.
+ * @param index_of a callable returning the index (in attributes) of the i-th point of the subset, for i in [0, k_nn)
+ * @param statistics the statistics to compute.
+ * @param buffer a buffer, reused between calls.
+ * @param results [n_statistics * n_channels] the statistics, statistic by statistic. NaN if the subset is empty.
+ */
+template <typename real_t, typename IndexAccessor>
+static void compute_neighborhood_statistics(
+    const real_t* attributes, const size_t n_channels, const size_t k_nn, IndexAccessor&& index_of,
+    const std::vector<EStatistic>& statistics, std::vector<real_t>& buffer, real_t* results)
+{
+    if (k_nn == 0)
+    {
+        std::fill(results, results + statistics.size() * n_channels, std::numeric_limits<real_t>::quiet_NaN());
+        return;
+    }
+
+    buffer.resize(k_nn * n_channels);
+    for (size_t i = 0; i < k_nn; ++i)
+    {
+        const real_t* point = &attributes[static_cast<size_t>(index_of(i)) * n_channels];
+        for (size_t c = 0; c < n_channels; ++c) { buffer[c * k_nn + i] = point[c]; }
+    }
+
+    for (size_t c = 0; c < n_channels; ++c)
+    {
+        real_t* values = &buffer[c * k_nn];
+        double  sum    = 0.0;
+        for (size_t i = 0; i < k_nn; ++i) { sum += values[i]; }
+        const double mean = sum / double(k_nn);
+
+        for (size_t s = 0; s < statistics.size(); ++s)
+        {
+            real_t& result = results[s * n_channels + c];
+            switch (statistics[s])
+            {
+                case EStatistic::Mean:
+                    result = static_cast<real_t>(mean);
+                    break;
+                case EStatistic::Std:
+                {
+                    double sum_sq = 0.0;
+                    for (size_t i = 0; i < k_nn; ++i) { sum_sq += (values[i] - mean) * (values[i] - mean); }
+                    result = static_cast<real_t>(std::sqrt(sum_sq / double(k_nn)));
+                    break;
+                }
+                case EStatistic::Min:
+                    result = *std::min_element(values, values + k_nn);
+                    break;
+                case EStatistic::Max:
+                    result = *std::max_element(values, values + k_nn);
+                    break;
+                case EStatistic::Median:
+                {
+                    // The values are only reordered, the other statistics are unaffected
+                    real_t* middle = values + k_nn / 2;
+                    std::nth_element(values, middle, values + k_nn);
+                    result = *middle;
+                    if (k_nn % 2 == 0) { result = (result + *std::max_element(values, middle)) / real_t(2.0); }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Check a (n_points, n_channels) array of attributes.
+ *
+ * @param attributes the attributes.
+ * @param n_points the expected number of points.
+ */
+template <typename real_t>
+static void check_attributes(
+    const nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>& attributes, const size_t n_points)
+{
+    if (attributes.shape(0) != n_points) { throw std::invalid_argument("attributes should hold one row per point"); }
+    if (attributes.shape(1) == 0) { throw std::invalid_argument("attributes should hold at least one channel"); }
+}
+
+/**
+ * Check the optional attributes whose statistics are computed along with the features, from the same search.
+ *
+ * @param attributes optional [n_points, n_channels] per-point attributes.
+ * @param statistics the names of the statistics of the attributes.
+ * @param n_points the number of points.
+ * @param stats the statistics to compute, empty if the attributes are not given.
+ * @return the number of statistics columns, i.e. n_statistics * n_channels, 0 if the attributes are not given.
+ */
+template <typename real_t>
+static size_t prepare_fused_statistics(
+    const std::optional<nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>>& attributes,
+    const std::vector<std::string>& statistics, const size_t n_points, std::vector<EStatistic>& stats)
+{
+    stats.clear();
+    if (!attributes) return 0;
+    check_attributes(*attributes, n_points);
+    stats = statistics_from_strings(statistics);
+    return stats.size() * attributes->shape(1);
+}
+
+/**
+ * Compute statistics of per-point attributes over neighborhoods given in CSR format.
+ *
+ * @param attributes [n_points, n_channels] the attributes, e.g. intensity, return number or RGB.
+ * @param nn the flattened neighbor indices.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'.
+ * @param statistics a list of 'mean', 'std', 'min', 'max' or 'median'.
+ * @return the statistics of each neighborhood in a (n_points, n_statistics, n_channels) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::ndim<3>> neighborhood_statistics_csr(
+    nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig> attributes, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+    nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr, const std::vector<std::string>& statistics)
+{
+    if (nn_ptr.size() == 0) { throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers"); }
+    const size_t                  n_points    = nn_ptr.size() - 1;
+    const size_t                  n_channels  = attributes.shape(1);
+    const uint32_t*               nn_data     = nn.data();
+    const uint32_t*               nn_ptr_data = nn_ptr.data();
+    const std::vector<EStatistic> stats       = statistics_from_strings(statistics);
+    check_attributes(attributes, n_points);
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    for (uint32_t e = 0; e < nn_ptr_data[n_points]; ++e)
+    {
+        if (nn_data[e] >= n_points)
+        {
+            throw std::invalid_argument("neighbor indices should be lower than the number of points");
+        }
+    }
+
+    const size_t row_size = stats.size() * n_channels;
+    real_t*      results  = new real_t[n_points * row_size];
+    nb::capsule  owner_results(results, [](void* p) noexcept { delete[] (real_t*)p; });
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i_point)
+        {
+            thread_local std::vector<real_t> buffer;
+            const uint32_t                   begin = nn_ptr_data[i_point];
+            compute_neighborhood_statistics(
+                attributes.data(), n_channels, nn_ptr_data[i_point + 1] - begin,
+                [&](const size_t i) { return nn_data[begin + i]; }, stats, buffer, &results[i_point * row_size]);
+        },
+        tf::StaticPartitioner(0));
+    executor.run(taskflow).get();
+
+    const size_t shape[3] = {n_points, stats.size(), n_channels};
+    return nb::ndarray<nb::numpy, real_t, nb::ndim<3>>(results, 3, shape, owner_results);
+}
+
+/**
+ * Compute statistics of per-point attributes over the neighbors within a radius of each point.
+ *
+ * @param xyz the point cloud.
+ * @param attributes [n_points, n_channels] the attributes, e.g. intensity, return number or RGB.
+ * @param search_radius the search radius.
+ * @param max_knn the maximum number of neighbors to fetch inside the radius. The central point is included.
+ * @param statistics a list of 'mean', 'std', 'min', 'max' or 'median'.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the statistics of each neighborhood in a (n_points, n_statistics, n_channels) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::ndim<3>> neighborhood_statistics_radius(
+    RefCloud<real_t> xyz, nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig> attributes, const real_t search_radius,
+    const uint32_t max_knn, const std::vector<std::string>& statistics, const std::string& backend)
+{
+    const size_t                  n_points   = static_cast<size_t>(xyz.rows());
+    const size_t                  n_channels = attributes.shape(1);
+    const std::vector<EStatistic> stats      = statistics_from_strings(statistics);
+    check_attributes(attributes, n_points);
+
+    const size_t                row_size         = stats.size() * n_channels;
+    const real_t                sq_search_radius = search_radius * search_radius;
+    const std::array<real_t, 3> weights          = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    real_t*                     results          = new real_t[n_points * row_size];
+    nb::capsule                 owner_results(results, [](void* p) noexcept { delete[] (real_t*)p; });
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    thread_local std::vector<uint32_t> neighbors;
+                    thread_local std::vector<real_t>   distances;
+                    thread_local std::vector<real_t>   buffer;
+                    neighbors.resize(max_knn);
+                    distances.resize(max_knn);
+                    nanoflann::RKNNResultSet<real_t, uint32_t, uint32_t> result_set(max_knn, sq_search_radius);
+                    result_set.init(neighbors.data(), distances.data());
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    compute_neighborhood_statistics(
+                        attributes.data(), n_channels, result_set.size(), [&](const size_t i) { return neighbors[i]; },
+                        stats, buffer, &results[point_id * row_size]);
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape[3] = {n_points, stats.size(), n_channels};
+    return nb::ndarray<nb::numpy, real_t, nb::ndim<3>>(results, 3, shape, owner_results);
+}
+
+}  // namespace pgeof
@@ -3,18 +3,266 @@
 #include <nanobind/eigen/dense.h>
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/pair.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/variant.h>
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <nanoflann.hpp>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
 #include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/algorithm/scan.hpp>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 
+#include "search_index.hpp"
 #include "pca.hpp"
 namespace nb = nanobind;
 
 namespace pgeof
 {
+/**
+ * A nanoflann result set keeping the 'capacity' closest points found inside a search radius.
+ *
+ * Points are stored in a max-heap ordered by distance, so each insertion costs O(log(capacity)) and, once the heap
+ * is full, the search radius shrinks to the distance of the current worst neighbor. The storage is provided by the
+ * caller and is only cleared (not freed) by init(), so it can be reused from one query to the next.
+ */
+template <typename real_t, typename index_t>
+class BoundedHeapResultSet
+{
+   public:
+    using item_t = nanoflann::ResultItem<index_t, real_t>;
+
+    BoundedHeapResultSet(std::vector<item_t>& heap, const size_t capacity, const real_t sq_radius)
+        : heap_(heap), capacity_(capacity), sq_radius_(sq_radius)
+    {
+        init();
+    }
+
+    void init()
+    {
+        heap_.clear();
+        heap_.reserve(capacity_);
+    }
+    size_t size() const { return heap_.size(); }
+    bool   empty() const { return heap_.empty(); }
+    bool   full() const { return heap_.size() == capacity_; }
+
+    bool addPoint(const real_t dist, const index_t index)
+    {
+        if (heap_.size() < capacity_)
+        {
+            heap_.emplace_back(index, dist);
+            std::push_heap(heap_.begin(), heap_.end(), nanoflann::IndexDist_Sorter());
+        }
+        else if (capacity_ > 0 && dist < heap_.front().second)
+        {
+            std::pop_heap(heap_.begin(), heap_.end(), nanoflann::IndexDist_Sorter());
+            heap_.back() = item_t(index, dist);
+            std::push_heap(heap_.begin(), heap_.end(), nanoflann::IndexDist_Sorter());
+        }
+        // always continue the search
+        return true;
+    }
+
+    real_t worstDist() const
+    {
+        if (heap_.size() < capacity_) { return sq_radius_; }
+        return capacity_ > 0 ? heap_.front().second : real_t(0.);
+    }
+
+    /**
+     * Sort the neighbors by increasing distance. The heap property is lost, so no point should be added afterwards.
+     */
+    void sort() { std::sort_heap(heap_.begin(), heap_.end(), nanoflann::IndexDist_Sorter()); }
+
+   private:
+    std::vector<item_t>& heap_;
+    const size_t         capacity_;
+    const real_t         sq_radius_;
+};
+
+/**
+ * A nanoflann result set counting the points found inside a search radius, and stopping the search as soon as a given
+ * number of points is reached. No neighbor is stored.
+ */
+template <typename real_t>
+class CountResultSet
+{
+   public:
+    CountResultSet(const size_t target, const real_t sq_radius) : target_(target), sq_radius_(sq_radius) {}
+
+    size_t size() const { return count_; }
+    bool   empty() const { return count_ == 0; }
+    bool   full() const { return count_ >= target_; }
+
+    template <typename index_t>
+    bool addPoint(const real_t, const index_t)
+    {
+        ++count_;
+        return count_ < target_;
+    }
+
+    real_t worstDist() const { return sq_radius_; }
+
+   private:
+    size_t       count_ = 0;
+    const size_t target_;
+    const real_t sq_radius_;
+};
+
+/**
+ * A nanoflann result set calling a visitor on every point found inside a search radius, e.g. to merge it into a
+ * cluster, instead of storing it. The search stops if the visitor returns false.
+ */
+template <typename real_t, typename Visitor>
+class VisitResultSet
+{
+   public:
+    VisitResultSet(Visitor& visitor, const real_t sq_radius) : visitor_(visitor), sq_radius_(sq_radius) {}
+
+    size_t size() const { return count_; }
+    bool   empty() const { return count_ == 0; }
+    bool   full() const { return false; }
+
+    template <typename index_t>
+    bool addPoint(const real_t, const index_t index)
+    {
+        ++count_;
+        return visitor_(index);
+    }
+
+    real_t worstDist() const { return sq_radius_; }
+
+   private:
+    Visitor&     visitor_;
+    size_t       count_ = 0;
+    const real_t sq_radius_;
+};
+
+/**
+ * A nanoflann result set adaptor discarding one given index, typically the query point itself when a point cloud is
+ * searched for its own neighbors. Other points are forwarded to the wrapped result set.
+ */
+template <typename ResultSet>
+class ExcludeIndexResultSet
+{
+   public:
+    ExcludeIndexResultSet(ResultSet& result_set, const Eigen::Index excluded_index)
+        : result_set_(result_set), excluded_index_(excluded_index)
+    {
+    }
+
+    size_t size() const { return result_set_.size(); }
+    bool   empty() const { return result_set_.empty(); }
+    bool   full() const { return result_set_.full(); }
+
+    template <typename real_t, typename index_t>
+    bool addPoint(const real_t dist, const index_t index)
+    {
+        if (static_cast<Eigen::Index>(index) == excluded_index_) { return true; }
+        return result_set_.addPoint(dist, index);
+    }
+
+    auto worstDist() const { return result_set_.worstDist(); }
+
+   private:
+    ResultSet&         result_set_;
+    const Eigen::Index excluded_index_;
+};
+
+/**
+ * Search the neighbors of a query point in a nanoflann index, optionally discarding the point of index 'query_id'
+ * from the results.
+ *
+ * @param index the nanoflann index
+ * @param result_set the nanoflann result set to fill
+ * @param query_point the query point coordinates
+ * @param exclude_self whether the point of index 'query_id' should be discarded
+ * @param query_id the index of the query point in the data point cloud
+ */
+template <typename index_t, typename ResultSet, typename real_t>
+static inline void find_neighbors(
+    const index_t& index, ResultSet& result_set, const real_t* query_point, const bool exclude_self,
+    const Eigen::Index query_id)
+{
+    if (exclude_self)
+    {
+        ExcludeIndexResultSet<ResultSet> filtered_result_set(result_set, query_id);
+        index.findNeighbors(filtered_result_set, query_point);
+    }
+    else { index.findNeighbors(result_set, query_point); }
+}
+
+/**
+ * Check the consistency of the search parameters when the query point is to be excluded from its neighbors: the query
+ * point cloud should be the data point cloud, i.e. the same memory with the same shape and strides.
+ *
+ * @param data the reference point cloud.
+ * @param query the point cloud used for the queries.
+ * @param exclude_self whether the query point is excluded from its neighbors.
+ * @return the number of excluded neighbors, i.e. 1 if exclude_self is true, 0 otherwise.
+ */
+template <typename cloud_t>
+static inline uint32_t check_exclude_self(const cloud_t& data, const cloud_t& query, const bool exclude_self)
+{
+    const bool same_cloud = data.data() == query.data() && data.rows() == query.rows() &&
+                            data.cols() == query.cols() && data.outerStride() == query.outerStride() &&
+                            data.innerStride() == query.innerStride();
+    if (exclude_self && !same_cloud)
+    {
+        throw std::invalid_argument("exclude_self requires the query point cloud to be the data point cloud");
+    }
+    return exclude_self ? 1 : 0;
+}
+
+/**
+ * Get the buffer a search should write its square distances to: the returned distances themselves when they have the
+ * precision of the search, a reused buffer otherwise (distances not returned, or returned with another precision).
+ *
+ * @param out_dist the returned distances of the query, nullptr if they are not returned.
+ * @param dist_buffer a reusable buffer.
+ * @param size the maximum number of neighbors of the query.
+ * @return the buffer to write the distances to.
+ */
+template <typename real_t, typename dist_t>
+static inline real_t* search_distances(dist_t* out_dist, std::vector<real_t>& dist_buffer, const size_t size)
+{
+    if constexpr (std::is_same_v<real_t, dist_t>)
+    {
+        if (out_dist != nullptr) { return out_dist; }
+    }
+    dist_buffer.resize(size);
+    return dist_buffer.data();
+}
+
+/**
+ * Convert the square distances written by a search to the returned distances, if needed (see search_distances).
+ *
+ * @param dist_buffer the buffer the search has written to.
+ * @param out_dist the returned distances of the query, nullptr if they are not returned.
+ * @param size the number of neighbors found.
+ */
+template <typename real_t, typename dist_t>
+static inline void store_distances(const std::vector<real_t>& dist_buffer, dist_t* out_dist, const size_t size)
+{
+    if constexpr (!std::is_same_v<real_t, dist_t>)
+    {
+        if (out_dist != nullptr) { std::copy_n(dist_buffer.data(), size, out_dist); }
+    }
+}
 
 /**
  * Given two point clouds, compute for each point present in one of the point cloud
@@ -25,45 +273,173 @@ namespace pgeof
  * @param data the reference point cloud.
  * @param query the point cloud used for the queries.
  * @param knn the number of neighbors to take into account for each point.
+ * @param return_distances whether the square distances should be returned. If false, they are not allocated.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * cloud to be the data point cloud (query 'i' being data point 'i'), 'knn' neighbors other than the query are returned.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @param weights the weight of each axis in the square distances (see with_search_index).
  * @return a pair of nd::array, both of size (n_points x knn), the first one contains the indices of each neighbor, the
- * second one the square distances between the query point and each of its neighbors.
+ * second one the square distances between the query point and each of its neighbors (None if return_distances is
+ * false).
  */
-template <typename real_t>
-static std::pair<nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>, nb::ndarray<nb::numpy, real_t, nb::ndim<2>>>
-    nanoflann_knn_search(RefCloud<real_t> data, RefCloud<real_t> query, const uint32_t knn)
+template <typename real_t, typename dist_t = real_t>
+static std::pair<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>, std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>>>
+    nanoflann_knn_search(
+        RefCloud<real_t> data, RefCloud<real_t> query, const uint32_t knn, const bool return_distances,
+        const bool exclude_self, const std::string& backend, const std::array<real_t, 3>& weights)
 {
-    using kd_tree_t = nanoflann::KDTreeEigenMatrixAdaptor<RefCloud<real_t>, 3, nanoflann::metric_L2_Simple>;
-
-    if (knn > data.rows()) { throw std::invalid_argument("knn size is greater than the data point cloud size"); }
+    const uint32_t n_excluded = check_exclude_self(data, query, exclude_self);
+    if (knn + n_excluded > data.rows())
+    {
+        throw std::invalid_argument("knn size is greater than the data point cloud size");
+    }
 
-    kd_tree_t          kd_tree(3, data, 10, 0);
     const Eigen::Index n_points = query.rows();
     uint32_t*          indices  = new uint32_t[knn * n_points];
     nb::capsule        owner_indices(indices, [](void* p) noexcept { delete[] (uint32_t*)p; });
 
-    real_t*     sqr_dist = new real_t[knn * n_points];
-    nb::capsule owner_dist(sqr_dist, [](void* p) noexcept { delete[] (real_t*)p; });
+    dist_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new dist_t[knn * n_points];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (dist_t*)p; });
+    }
 
     tf::Executor executor;
     tf::Taskflow taskflow;
-    taskflow.for_each_index(
-        Eigen::Index(0), n_points, Eigen::Index(1),
-        [&](Eigen::Index point_id)
+    with_search_index(
+        data, backend, weights,
+        [&](const auto& index)
         {
-            nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(knn);
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    // Distances are still needed by the search, they go to a reused buffer if they are not returned
+                    thread_local std::vector<real_t> dist_buffer;
 
-            const size_t id = point_id * knn;
-            result_set.init(&indices[id], &sqr_dist[id]);
-            kd_tree.index_->findNeighbors(result_set, query.row(point_id).data());
-        }),
-        tf::StaticPartitioner(0);
+                    nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(knn);
 
-    executor.run(taskflow).get();
+                    const size_t id       = point_id * knn;
+                    dist_t*      out_dist = return_distances ? &sqr_dist[id] : nullptr;
+                    result_set.init(&indices[id], search_distances<real_t>(out_dist, dist_buffer, knn));
+                    find_neighbors(index, result_set, query.row(point_id).data(), exclude_self, point_id);
+                    store_distances(dist_buffer, out_dist, result_set.size());
+                },
+                tf::StaticPartitioner(0));
+
+            executor.run(taskflow).get();
+        });
 
     const size_t shape[2] = {static_cast<size_t>(n_points), static_cast<size_t>(knn)};
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>> distances;
+    if (return_distances)
+    {
+        distances = nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist);
+    }
+    return {nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>(indices, 2, shape, owner_indices), distances};
+};
+
+/**
+ * Given two point clouds, compute for each point present in one of the point cloud its own number of closest points
+ * in the other point cloud, neighbors being returned in CSR format.
+ *
+ * The neighbor counts are known beforehand, so the CSR pointers are computed first with a parallel prefix sum, and
+ * each query then writes its neighbors directly at their final location.
+ *
+ * @param data the reference point cloud.
+ * @param query the point cloud used for the queries.
+ * @param knn [n_queries] the number of neighbors to take into account for each query.
+ * @param return_distances whether the square distances should be returned. If false, they are not allocated.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * cloud to be the data point cloud (query 'i' being data point 'i').
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @param weights the weight of each axis in the square distances (see with_search_index).
+ * @return a tuple of nd::array: 'nn' the flattened indices of the neighbors, sorted by increasing distance for each
+ * query, 'nn_ptr' [n_queries+1] pointers wrt 'nn' (the neighbors of query 'i' are 'nn[nn_ptr[i]:nn_ptr[i + 1]]') and
+ * the 'square_distances' between each query and its neighbors, aligned with 'nn' (None if return_distances is false).
+ */
+template <typename real_t, typename dist_t = real_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>>>
+    nanoflann_knn_search_csr(
+        RefCloud<real_t> data, RefCloud<real_t> query, nb::ndarray<const uint32_t, nb::ndim<1>> knn,
+        const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<real_t, 3>& weights)
+{
+    const uint32_t  n_excluded = check_exclude_self(data, query, exclude_self);
+    const size_t    n_points   = static_cast<size_t>(query.rows());
+    const uint32_t* knn_data   = knn.data();
+    if (knn.size() != n_points) { throw std::invalid_argument("knn should hold one size per query point"); }
+    if (n_points > 0 && *std::max_element(knn_data, knn_data + n_points) + n_excluded > data.rows())
+    {
+        throw std::invalid_argument("knn size is greater than the data point cloud size");
+    }
+    const size_t n_neighbors = std::accumulate(knn_data, knn_data + n_points, size_t(0));
+    if (n_neighbors > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many neighbors to be indexed with uint32 pointers");
+    }
+
+    uint32_t*   nn_ptr = new uint32_t[n_points + 1];
+    nb::capsule owner_nn_ptr(nn_ptr, [](void* p) noexcept { delete[] (uint32_t*)p; });
+    nn_ptr[0] = 0;
+
+    uint32_t*   indices = new uint32_t[n_neighbors];
+    nb::capsule owner_indices(indices, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    dist_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new dist_t[n_neighbors];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (dist_t*)p; });
+    }
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    with_search_index(
+        data, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Task scan =
+                taskflow.inclusive_scan(knn_data, knn_data + n_points, nn_ptr + 1, std::plus<uint32_t>());
+            tf::Task search = taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    thread_local std::vector<real_t> dist_buffer;
+
+                    const uint32_t point_knn = knn_data[point_id];
+                    if (point_knn == 0) return;
+                    nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(point_knn);
+
+                    const size_t id       = nn_ptr[point_id];
+                    dist_t*      out_dist = return_distances ? &sqr_dist[id] : nullptr;
+                    result_set.init(&indices[id], search_distances<real_t>(out_dist, dist_buffer, point_knn));
+                    find_neighbors(
+                        index, result_set, query.row(point_id).data(), exclude_self,
+                        static_cast<Eigen::Index>(point_id));
+                    store_distances(dist_buffer, out_dist, result_set.size());
+                },
+                tf::StaticPartitioner(0));
+            scan.precede(search);
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape_nn[1]     = {n_neighbors};
+    const size_t shape_nn_ptr[1] = {n_points + 1};
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>> distances;
+    if (return_distances)
+    {
+        distances = nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>(sqr_dist, 1, shape_nn, owner_dist);
+    }
     return {
-        nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>(indices, 2, shape, owner_indices),
-        nb::ndarray<nb::numpy, real_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist)};
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(indices, 1, shape_nn, owner_indices),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(nn_ptr, 1, shape_nn_ptr, owner_nn_ptr), distances};
 };
 
 /**
@@ -77,24 +453,30 @@ static std::pair<nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>, nb::ndarray<nb::
  * @param search_radius the search radius.
  * @param max_knn the maximum number of neighbors to fetch inside the radius. (Fixing a
  * reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.)
+ * @param return_distances whether the square distances should be returned. If false, they are not allocated.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * cloud to be the data point cloud (query 'i' being data point 'i').
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @param weights the weight of each axis in the square distances (see with_search_index).
  * @return a pair of nd::array, both of size (n_points x knn), the first one contains the 'indices' of each neighbor,
- * the second one the 'square_distances' between the query point and each neighbor. Point having a number of neighbors <
- * 'max_knn' inside the 'search_radius' will have their 'indices' and and 'square_distances' filled respectively with
- * '-1' and 'O' for any missing neighbor.
+ * the second one the 'square_distances' between the query point and each neighbor (None if return_distances is false).
+ * Point having a number of neighbors < 'max_knn' inside the 'search_radius' will have their 'indices' and
+ * 'square_distances' filled respectively with '-1' and 'O' for any missing neighbor.
  */
-template <typename real_t>
-static std::pair<nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>, nb::ndarray<nb::numpy, real_t, nb::ndim<2>>>
+template <typename real_t, typename dist_t = real_t>
+static std::pair<
+    nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>, std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>>>
     nanoflann_radius_search(
-        RefCloud<real_t> data, RefCloud<real_t> query, const real_t search_radius, const uint32_t max_knn)
+        RefCloud<real_t> data, RefCloud<real_t> query, const real_t search_radius, const uint32_t max_knn,
+        const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<real_t, 3>& weights)
 {
-    using kd_tree_t = nanoflann::KDTreeEigenMatrixAdaptor<RefCloud<real_t>, 3, nanoflann::metric_L2_Simple>;
-
-    if (max_knn > data.rows())
+    const uint32_t n_excluded = check_exclude_self(data, query, exclude_self);
+    if (max_knn + n_excluded > data.rows())
     {
         throw std::invalid_argument("max knn size is greater than the data point cloud size");
     }
 
-    kd_tree_t    kd_tree(3, data, 10, 0);
     const real_t sq_search_radius = search_radius * search_radius;
 
     const Eigen::Index n_points = query.rows();
@@ -103,32 +485,486 @@ static std::pair<nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>, nb::ndarray<nb::n
     nb::capsule owner_indices(indices, [](void* p) noexcept { delete[] (int32_t*)p; });
     std::fill(indices, indices + (max_knn * n_points), -1);
 
-    real_t*     sqr_dist = new real_t[max_knn * n_points];
-    nb::capsule owner_dist(sqr_dist, [](void* p) noexcept { delete[] (real_t*)p; });
-    std::fill(sqr_dist, sqr_dist + (max_knn * n_points), real_t(0.0));
+    dist_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new dist_t[max_knn * n_points];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (dist_t*)p; });
+        std::fill(sqr_dist, sqr_dist + (max_knn * n_points), dist_t(0.0));
+    }
 
     tf::Executor executor;
     tf::Taskflow taskflow;
 
-    taskflow.for_each_index(
-        Eigen::Index(0), n_points, Eigen::Index(1),
-        [&](Eigen::Index point_id)
+    with_search_index(
+        data, backend, weights,
+        [&](const auto& index)
         {
-            nanoflann::RKNNResultSet<real_t, int32_t, uint32_t> result_set(max_knn, sq_search_radius);
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    // Distances are still needed by the search, they go to a reused buffer if they are not returned
+                    thread_local std::vector<real_t> dist_buffer;
 
-            const size_t id = point_id * max_knn;
+                    nanoflann::RKNNResultSet<real_t, int32_t, uint32_t> result_set(max_knn, sq_search_radius);
 
-            result_set.init(&indices[id], &sqr_dist[id]);
-            kd_tree.index_->findNeighbors(result_set, query.row(point_id).data());
+                    const size_t id       = point_id * max_knn;
+                    dist_t*      out_dist = return_distances ? &sqr_dist[id] : nullptr;
+
+                    result_set.init(&indices[id], search_distances<real_t>(out_dist, dist_buffer, max_knn));
+                    find_neighbors(index, result_set, query.row(point_id).data(), exclude_self, point_id);
+                    store_distances(dist_buffer, out_dist, result_set.size());
+                    // nanoflann marks the last slot with the search radius, missing neighbors are reported at
+                    // distance 0
+                    if (out_dist != nullptr)
+                    {
+                        std::fill(out_dist + result_set.size(), out_dist + max_knn, dist_t(0.0));
+                    }
+                },
+                tf::StaticPartitioner(0));
+
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape[2] = {static_cast<size_t>(n_points), static_cast<size_t>(max_knn)};
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>> distances;
+    if (return_distances)
+    {
+        distances = nb::ndarray<nb::numpy, dist_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist);
+    }
+    return {nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>(indices, 2, shape, owner_indices), distances};
+};
+
+/**
+ * Search for the points within a per-query sphere in a point cloud, neighbors being returned in CSR format.
+ *
+ * Queries are processed by blocks: each block appends the neighbors of its queries to block-local buffers, so no
+ * allocation occurs per query and no padding to 'max_knn' is needed. The CSR pointers are then obtained with a
+ * parallel prefix sum of the neighbor counts, and the block buffers are moved into the final arrays.
+ *
+ * @param data the reference point cloud.
+ * @param query the point cloud used for the queries (sphere centers)
+ * @param search_radius [n_queries] the search radius of each query.
+ * @param max_knn the maximum number of neighbors to fetch inside each radius.
+ * @param return_distances whether the square distances should be returned. If false, they are not stored.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * cloud to be the data point cloud (query 'i' being data point 'i').
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @param weights the weight of each axis in the square distances (see with_search_index).
+ * @return a tuple of nd::array: 'nn' the flattened indices of the neighbors, sorted by increasing distance for each
+ * query, 'nn_ptr' [n_queries+1] pointers wrt 'nn' (the neighbors of query 'i' are 'nn[nn_ptr[i]:nn_ptr[i + 1]]') and
+ * the 'square_distances' between each query and its neighbors, aligned with 'nn' (None if return_distances is false).
+ */
+template <typename real_t, typename dist_t = real_t>
+static std::tuple<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>,
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>>>
+    nanoflann_radius_search_csr(
+        RefCloud<real_t> data, RefCloud<real_t> query, nb::ndarray<const real_t, nb::ndim<1>> search_radius,
+        const uint32_t max_knn, const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<real_t, 3>& weights)
+{
+    using result_item_t = nanoflann::ResultItem<Eigen::Index, real_t>;
+    constexpr size_t block_size = 1024;
+
+    const uint32_t n_excluded = check_exclude_self(data, query, exclude_self);
+    if (max_knn + n_excluded > data.rows())
+    {
+        throw std::invalid_argument("max knn size is greater than the data point cloud size");
+    }
+    if (search_radius.size() != static_cast<size_t>(query.rows()))
+    {
+        throw std::invalid_argument("search_radius should hold one radius per query point");
+    }
+
+    const size_t  n_points    = static_cast<size_t>(query.rows());
+    const size_t  n_blocks    = (n_points + block_size - 1) / block_size;
+    const real_t* radius_data = search_radius.data();
+
+    std::vector<std::vector<uint32_t>> block_indices(n_blocks);
+    std::vector<std::vector<dist_t>>   block_sqr_dist(n_blocks);
+
+    uint32_t*   nn_ptr = new uint32_t[n_points + 1];
+    nb::capsule owner_nn_ptr(nn_ptr, [](void* p) noexcept { delete[] (uint32_t*)p; });
+    nn_ptr[0] = 0;
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    with_search_index(
+        data, backend, weights,
+        [&](const auto& index)
+        {
+            taskflow.for_each_index(
+                size_t(0), n_blocks, size_t(1),
+                [&](size_t i_block)
+                {
+                    thread_local std::vector<result_item_t> neighbors;
+
+                    const size_t end = std::min(n_points, (i_block + 1) * block_size);
+                    for (size_t point_id = i_block * block_size; point_id < end; ++point_id)
+                    {
+                        const real_t radius = radius_data[point_id];
+                        BoundedHeapResultSet<real_t, Eigen::Index> result_set(neighbors, max_knn, radius * radius);
+                        find_neighbors(
+                            index, result_set, query.row(point_id).data(), exclude_self,
+                            static_cast<Eigen::Index>(point_id));
+                        result_set.sort();
+                        for (const auto& neighbor : neighbors)
+                        {
+                            block_indices[i_block].push_back(static_cast<uint32_t>(neighbor.first));
+                            if (return_distances)
+                            {
+                                block_sqr_dist[i_block].push_back(static_cast<dist_t>(neighbor.second));
+                            }
+                        }
+                        // Neighbor counts are stored in the pointers array, before the prefix sum
+                        nn_ptr[point_id + 1] = static_cast<uint32_t>(neighbors.size());
+                    }
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    size_t n_neighbors = 0;
+    for (const auto& indices : block_indices) { n_neighbors += indices.size(); }
+    if (n_neighbors > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many neighbors to be indexed with uint32 pointers");
+    }
+
+    uint32_t*   indices = new uint32_t[n_neighbors];
+    nb::capsule owner_indices(indices, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    dist_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new dist_t[n_neighbors];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (dist_t*)p; });
+    }
+
+    taskflow.clear();
+    tf::Task scan   = taskflow.inclusive_scan(nn_ptr + 1, nn_ptr + n_points + 1, nn_ptr + 1, std::plus<uint32_t>());
+    tf::Task gather = taskflow.for_each_index(
+        size_t(0), n_blocks, size_t(1),
+        [&](size_t i_block)
+        {
+            const uint32_t offset = nn_ptr[i_block * block_size];
+            std::copy(block_indices[i_block].begin(), block_indices[i_block].end(), indices + offset);
+            if (return_distances)
+            {
+                std::copy(block_sqr_dist[i_block].begin(), block_sqr_dist[i_block].end(), sqr_dist + offset);
+            }
+            // Release the block buffers as soon as possible
+            std::vector<uint32_t>().swap(block_indices[i_block]);
+            std::vector<dist_t>().swap(block_sqr_dist[i_block]);
         },
         tf::StaticPartitioner(0));
-
+    scan.precede(gather);
     executor.run(taskflow).get();
 
-    const size_t shape[2] = {static_cast<size_t>(n_points), static_cast<size_t>(max_knn)};
+    const size_t shape_nn[1]     = {n_neighbors};
+    const size_t shape_nn_ptr[1] = {n_points + 1};
+    std::optional<nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>> distances;
+    if (return_distances)
+    {
+        distances = nb::ndarray<nb::numpy, dist_t, nb::ndim<1>>(sqr_dist, 1, shape_nn, owner_dist);
+    }
     return {
-        nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>(indices, 2, shape, owner_indices),
-        nb::ndarray<nb::numpy, real_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist)};
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(indices, 1, shape_nn, owner_indices),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(nn_ptr, 1, shape_nn_ptr, owner_nn_ptr), distances};
+};
+
+// Dimensions of the feature spaces for which the search is specialized at compile time (11 being the number of
+// pgeof features, 14 the features and a color)
+using search_dimensions_t = std::integer_sequence<int, 2, 3, 4, 6, 8, 11, 14, 16>;
+
+// A row-major matrix view whose number of columns is fixed at compile time (unless DIM is -1)
+template <typename real_t, int DIM>
+using FixedColsMap =
+    Eigen::Map<const Eigen::Matrix<real_t, Eigen::Dynamic, DIM, Eigen::RowMajor>, 0, Eigen::OuterStride<>>;
+
+/**
+ * Call a function with the dimension of a feature space as a compile-time constant if it is one of
+ * search_dimensions_t, with nanoflann dynamic dimension (-1) otherwise.
+ *
+ * @param dim the dimension of the feature space
+ * @param function a generic lambda taking a std::integral_constant<int, DIM>
+ * @return the value returned by the function
+ */
+template <typename Function, int DIM, int... DIMS>
+static auto dispatch_dimension(
+    const Eigen::Index dim, Function&& function, std::integer_sequence<int, DIM, DIMS...>)
+{
+    if (dim == DIM) { return function(std::integral_constant<int, DIM>{}); }
+    if constexpr (sizeof...(DIMS) > 0)
+    {
+        return dispatch_dimension(dim, std::forward<Function>(function), std::integer_sequence<int, DIMS...>{});
+    }
+    else { return function(std::integral_constant<int, -1>{}); }
+}
+
+template <typename Function>
+static auto dispatch_dimension(const Eigen::Index dim, Function&& function)
+{
+    return dispatch_dimension(dim, std::forward<Function>(function), search_dimensions_t{});
+}
+
+/**
+ * Given two point sets of any dimension (e.g. feature vectors), compute for each query point its N closest points in
+ * the reference set, see nanoflann_knn_search for the 3D point clouds.
+ *
+ * @param data the reference points, (n_points, dim).
+ * @param query the query points, (n_queries, dim).
+ * @param knn the number of neighbors to take into account for each point.
+ * @param return_distances whether the square distances should be returned. If false, they are not allocated.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * set to be the data point set (query 'i' being data point 'i').
+ * @return a pair of nd::array, both of size (n_queries x knn), the neighbor indices and the square distances (None if
+ * return_distances is false).
+ */
+template <typename real_t>
+static std::pair<
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>, std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<2>>>>
+    nanoflann_knn_search_nd(
+        RefMatrixCloud<real_t> data, RefMatrixCloud<real_t> query, const uint32_t knn, const bool return_distances,
+        const bool exclude_self)
+{
+    const uint32_t n_excluded = check_exclude_self(data, query, exclude_self);
+    if (data.cols() != query.cols()) { throw std::invalid_argument("data and query should have the same dimension"); }
+    if (knn + n_excluded > data.rows())
+    {
+        throw std::invalid_argument("knn size is greater than the data point cloud size");
+    }
+
+    const Eigen::Index n_points = query.rows();
+    uint32_t*          indices  = new uint32_t[knn * n_points];
+    nb::capsule        owner_indices(indices, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    real_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new real_t[knn * n_points];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (real_t*)p; });
+    }
+
+    dispatch_dimension(
+        data.cols(),
+        [&](auto dim)
+        {
+            // nanoflann takes the dimension of the index from the number of columns of the matrix type
+            constexpr int DIM = decltype(dim)::value;
+            using matrix_t    = FixedColsMap<real_t, DIM>;
+            using kd_tree_t   = nanoflann::KDTreeEigenMatrixAdaptor<matrix_t, DIM, nanoflann::metric_L2_Simple>;
+
+            const matrix_t points(data.data(), data.rows(), data.cols(), Eigen::OuterStride<>(data.outerStride()));
+            kd_tree_t      kd_tree(static_cast<int>(data.cols()), points, 10, 0);
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    thread_local std::vector<real_t> dist_buffer;
+
+                    const size_t id       = point_id * knn;
+                    real_t*      out_dist = return_distances ? &sqr_dist[id] : nullptr;
+                    nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(knn);
+                    result_set.init(&indices[id], search_distances<real_t>(out_dist, dist_buffer, knn));
+                    find_neighbors(*kd_tree.index_, result_set, query.row(point_id).data(), exclude_self, point_id);
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape[2] = {static_cast<size_t>(n_points), static_cast<size_t>(knn)};
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<2>>> distances;
+    if (return_distances) { distances = nb::ndarray<nb::numpy, real_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist); }
+    return {nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>(indices, 2, shape, owner_indices), distances};
+}
+
+/**
+ * Search for the points within a sphere in a point set of any dimension (e.g. feature vectors), see
+ * nanoflann_radius_search for the 3D point clouds.
+ *
+ * @param data the reference points, (n_points, dim).
+ * @param query the query points (sphere centers), (n_queries, dim).
+ * @param search_radius the search radius.
+ * @param max_knn the maximum number of neighbors to fetch inside the radius.
+ * @param return_distances whether the square distances should be returned. If false, they are not allocated.
+ * @param exclude_self whether each query point should be excluded from its own neighbors. It requires the query point
+ * set to be the data point set (query 'i' being data point 'i').
+ * @return a pair of nd::array, both of size (n_queries x max_knn), the neighbor indices and the square distances (None
+ * if return_distances is false). Missing neighbors have their index set to '-1' and their distance to '0'.
+ */
+template <typename real_t>
+static std::pair<
+    nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>, std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<2>>>>
+    nanoflann_radius_search_nd(
+        RefMatrixCloud<real_t> data, RefMatrixCloud<real_t> query, const real_t search_radius,
+        const uint32_t max_knn, const bool return_distances, const bool exclude_self)
+{
+    const uint32_t n_excluded = check_exclude_self(data, query, exclude_self);
+    if (data.cols() != query.cols()) { throw std::invalid_argument("data and query should have the same dimension"); }
+    if (max_knn + n_excluded > data.rows())
+    {
+        throw std::invalid_argument("max knn size is greater than the data point cloud size");
+    }
+
+    const real_t       sq_search_radius = search_radius * search_radius;
+    const Eigen::Index n_points         = query.rows();
+
+    int32_t*    indices = new int32_t[max_knn * n_points];
+    nb::capsule owner_indices(indices, [](void* p) noexcept { delete[] (int32_t*)p; });
+    std::fill(indices, indices + (max_knn * n_points), -1);
+
+    real_t*     sqr_dist = nullptr;
+    nb::capsule owner_dist;
+    if (return_distances)
+    {
+        sqr_dist   = new real_t[max_knn * n_points];
+        owner_dist = nb::capsule(sqr_dist, [](void* p) noexcept { delete[] (real_t*)p; });
+    }
+
+    dispatch_dimension(
+        data.cols(),
+        [&](auto dim)
+        {
+            // nanoflann takes the dimension of the index from the number of columns of the matrix type
+            constexpr int DIM = decltype(dim)::value;
+            using matrix_t    = FixedColsMap<real_t, DIM>;
+            using kd_tree_t   = nanoflann::KDTreeEigenMatrixAdaptor<matrix_t, DIM, nanoflann::metric_L2_Simple>;
+
+            const matrix_t points(data.data(), data.rows(), data.cols(), Eigen::OuterStride<>(data.outerStride()));
+            kd_tree_t      kd_tree(static_cast<int>(data.cols()), points, 10, 0);
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    thread_local std::vector<real_t> dist_buffer;
+
+                    const size_t id       = point_id * max_knn;
+                    real_t*      out_dist = return_distances ? &sqr_dist[id] : nullptr;
+                    nanoflann::RKNNResultSet<real_t, int32_t, uint32_t> result_set(max_knn, sq_search_radius);
+                    result_set.init(&indices[id], search_distances<real_t>(out_dist, dist_buffer, max_knn));
+                    find_neighbors(*kd_tree.index_, result_set, query.row(point_id).data(), exclude_self, point_id);
+                    // nanoflann marks the last slot with the search radius, missing neighbors are reported at
+                    // distance 0
+                    if (out_dist != nullptr)
+                    {
+                        std::fill(out_dist + result_set.size(), out_dist + max_knn, real_t(0.0));
+                    }
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape[2] = {static_cast<size_t>(n_points), static_cast<size_t>(max_knn)};
+    std::optional<nb::ndarray<nb::numpy, real_t, nb::ndim<2>>> distances;
+    if (return_distances) { distances = nb::ndarray<nb::numpy, real_t, nb::ndim<2>>(sqr_dist, 2, shape, owner_dist); }
+    return {nb::ndarray<nb::numpy, int32_t, nb::ndim<2>>(indices, 2, shape, owner_indices), distances};
+}
+
+// Return type of a search function
+template <typename search_t>
+struct search_result;
+
+template <typename result_t, typename... args_t>
+struct search_result<result_t (*)(args_t...)>
+{
+    using type = result_t;
 };
 
+template <auto search>
+using search_result_t = typename search_result<decltype(search)>::type;
+
+/**
+ * knn search of a double precision point cloud, see nanoflann_knn_search. The square distances are computed in double
+ * precision and returned either in double or in single precision ('float32_distances').
+ */
+static std::variant<
+    search_result_t<&nanoflann_knn_search<double, double>>, search_result_t<&nanoflann_knn_search<double, float>>>
+    nanoflann_knn_search_double(
+        RefCloud<double> data, RefCloud<double> query, const uint32_t knn, const bool return_distances,
+        const bool exclude_self, const std::string& backend, const std::array<double, 3>& weights,
+        const bool float32_distances)
+{
+    if (float32_distances)
+    {
+        return nanoflann_knn_search<double, float>(
+            data, query, knn, return_distances, exclude_self, backend, weights);
+    }
+    return nanoflann_knn_search<double, double>(
+        data, query, knn, return_distances, exclude_self, backend, weights);
+}
+
+/**
+ * knn search of a double precision point cloud with a per-query number of neighbors, see nanoflann_knn_search_csr.
+ * The square distances are computed in double precision and returned either in double or in single precision
+ * ('float32_distances').
+ */
+static std::variant<
+    search_result_t<&nanoflann_knn_search_csr<double, double>>,
+    search_result_t<&nanoflann_knn_search_csr<double, float>>>
+    nanoflann_knn_search_csr_double(
+        RefCloud<double> data, RefCloud<double> query, nb::ndarray<const uint32_t, nb::ndim<1>> knn,
+        const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<double, 3>& weights, const bool float32_distances)
+{
+    if (float32_distances)
+    {
+        return nanoflann_knn_search_csr<double, float>(
+            data, query, knn, return_distances, exclude_self, backend, weights);
+    }
+    return nanoflann_knn_search_csr<double, double>(data, query, knn, return_distances, exclude_self, backend, weights);
+}
+
+/**
+ * Radius search in a double precision point cloud, see nanoflann_radius_search. The square distances are computed in
+ * double precision and returned either in double or in single precision ('float32_distances').
+ */
+static std::variant<
+    search_result_t<&nanoflann_radius_search<double, double>>,
+    search_result_t<&nanoflann_radius_search<double, float>>>
+    nanoflann_radius_search_double(
+        RefCloud<double> data, RefCloud<double> query, const double search_radius, const uint32_t max_knn,
+        const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<double, 3>& weights, const bool float32_distances)
+{
+    if (float32_distances)
+    {
+        return nanoflann_radius_search<double, float>(
+            data, query, search_radius, max_knn, return_distances, exclude_self, backend, weights);
+    }
+    return nanoflann_radius_search<double, double>(
+        data, query, search_radius, max_knn, return_distances, exclude_self, backend, weights);
+}
+
+/**
+ * Radius search in a double precision point cloud with a per-query radius, see nanoflann_radius_search_csr. The square
+ * distances are computed in double precision and returned either in double or in single precision
+ * ('float32_distances').
+ */
+static std::variant<
+    search_result_t<&nanoflann_radius_search_csr<double, double>>,
+    search_result_t<&nanoflann_radius_search_csr<double, float>>>
+    nanoflann_radius_search_csr_double(
+        RefCloud<double> data, RefCloud<double> query, nb::ndarray<const double, nb::ndim<1>> search_radius,
+        const uint32_t max_knn, const bool return_distances, const bool exclude_self, const std::string& backend,
+        const std::array<double, 3>& weights, const bool float32_distances)
+{
+    if (float32_distances)
+    {
+        return nanoflann_radius_search_csr<double, float>(
+            data, query, search_radius, max_knn, return_distances, exclude_self, backend, weights);
+    }
+    return nanoflann_radius_search_csr<double, double>(
+        data, query, search_radius, max_knn, return_distances, exclude_self, backend, weights);
+}
+
 }  // namespace pgeof
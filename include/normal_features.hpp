@@ -0,0 +1,218 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <nanoflann.hpp>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <utility>
+#include <vector>
+
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// Number of features computed by compute_normal_features
+constexpr size_t normal_feature_count = 5;
+
+/**
+ * Compute the normal of each point and second order features of its neighborhood, in two parallel stages over the
+ * same neighborhoods: the normals are computed first, then the features comparing the normal of each point with the
+ * normals of its neighbors and with its normal at a smaller scale.
+ *
+ * The features of each point are:
+ *  - 0, 1, 2: the normal, oriented towards +z, as the Normal_x, Normal_y and Normal_z features.
+ *  - 3: the normal variation, i.e. the mean angle (in radians) between the normal and the normals of the neighbors.
+ *  - 4: the normal change, i.e. the angle (in radians) between the normal and the normal computed on the neighbors of
+ *  the smaller scale.
+ * Angles are computed between unoriented normals, they lie in [0, pi/2]. Points with less than k_min neighbors have
+ * null features and are ignored by the normal variation of their neighbors. The normal change is null if there are
+ * less than 3 neighbors at the smaller scale.
+ *
+ * @param xyz the point cloud.
+ * @param nn the neighbor indices.
+ * @param row_range a functor giving the range [begin, end) of the neighbors of a point in 'nn'.
+ * @param in_small_scale a functor telling if the r-th neighbor of a point, at position e in 'nn', is in the smaller
+ * scale, called as 'in_small_scale(r, e)'.
+ * @param k_min the minimum number of neighbors to compute the features of a point.
+ * @return the features in a (n_points, 5) nd::array.
+ */
+template <typename real_t, typename row_range_t, typename small_scale_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(normal_feature_count)>>
+    compute_normal_features(
+        RefCloud<real_t> xyz, const uint32_t* nn, const row_range_t& row_range, const small_scale_t& in_small_scale,
+        const size_t k_min)
+{
+    if (k_min < 1) { throw std::invalid_argument("k_min should be > 1"); }
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+
+    real_t*     features = new real_t[n_points * normal_feature_count];
+    nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
+    std::fill(features, features + n_points * normal_feature_count, real_t(0.0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    tf::Task     normals = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            const auto [begin, end] = row_range(i);
+            if (end - begin < k_min) return;
+            const PCAResult<real_t> pca =
+                pca_from_indices<real_t>(xyz, end - begin, [&, begin = begin](const size_t r) { return nn[begin + r]; });
+            for (size_t d = 0; d < 3; ++d) { features[i * normal_feature_count + d] = pca.v2(d); }
+        },
+        tf::StaticPartitioner(0));
+    tf::Task second_order = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            thread_local std::vector<uint32_t> small_scale;
+            const auto [begin, end] = row_range(i);
+            if (end - begin < k_min) return;
+
+            real_t*                              point_features = &features[i * normal_feature_count];
+            const Eigen::Map<const Vec3<real_t>> normal(point_features);
+            real_t                               variation   = real_t(0.0);
+            size_t                               n_variation = 0;
+            small_scale.clear();
+            for (size_t e = begin; e < end; ++e)
+            {
+                const size_t j = nn[e];
+                if (in_small_scale(e - begin, e)) { small_scale.push_back(nn[e]); }
+                if (j == i) continue;
+                const auto [begin_j, end_j] = row_range(j);
+                if (end_j - begin_j < k_min) continue;
+                const Eigen::Map<const Vec3<real_t>> neighbor(&features[j * normal_feature_count]);
+                variation += std::acos(std::min(real_t(1.0), std::abs(normal.dot(neighbor))));
+                ++n_variation;
+            }
+            if (n_variation > 0) { point_features[3] = variation / real_t(n_variation); }
+            if (small_scale.size() >= 3)
+            {
+                const PCAResult<real_t> pca = pca_from_indices<real_t>(
+                    xyz, small_scale.size(), [&](const size_t r) { return small_scale[r]; });
+                point_features[4] = std::acos(std::min(real_t(1.0), std::abs(normal.dot(pca.v2))));
+            }
+        },
+        tf::StaticPartitioner(0));
+    normals.precede(second_order);
+    executor.run(taskflow).get();
+
+    const size_t shape[2] = {n_points, normal_feature_count};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(normal_feature_count)>>(
+        features, 2, shape, owner_features);
+}
+
+/**
+ * Compute the normals and their second order features from neighbors given in CSR format, see
+ * compute_normal_features. The smaller scale of a point is made of its first 'k_small' neighbors, which should be
+ * sorted by distance (e.g. the output of knn_search).
+ *
+ * @param xyz the point cloud.
+ * @param nn the flattened neighbor indices.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'.
+ * @param k_small the number of neighbors of the smaller scale.
+ * @param k_min the minimum number of neighbors to compute the features of a point.
+ * @return the features in a (n_points, 5) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(normal_feature_count)>>
+    compute_normal_features_csr(
+        RefCloud<real_t> xyz, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+        nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr, const size_t k_small, const size_t k_min)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (nn_ptr.size() != n_points + 1) { throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers"); }
+    const uint32_t* nn_data     = nn.data();
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    for (uint32_t e = 0; e < nn_ptr_data[n_points]; ++e)
+    {
+        if (nn_data[e] >= n_points)
+        {
+            throw std::invalid_argument("neighbor indices should be lower than the number of points");
+        }
+    }
+    return compute_normal_features<real_t>(
+        xyz, nn_data,
+        [nn_ptr_data](const size_t i)
+        { return std::pair<size_t, size_t>(nn_ptr_data[i], nn_ptr_data[i + 1]); },
+        [k_small](const size_t r, const size_t) { return r < k_small; }, k_min);
+}
+
+/**
+ * Compute the normals and their second order features from the neighbors within a radius of each point, see
+ * compute_normal_features. The neighbors are searched once, in parallel, and reused by both stages. The smaller scale
+ * of a point is made of its neighbors within 'small_radius'.
+ *
+ * @param xyz the point cloud.
+ * @param search_radius the search radius.
+ * @param small_radius the radius of the smaller scale, lower than the search radius.
+ * @param max_knn the maximum number of neighbors to fetch inside the radius. The central point is included.
+ * @param k_min the minimum number of neighbors to compute the features of a point.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return the features in a (n_points, 5) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(normal_feature_count)>>
+    compute_normal_features_radius(
+        RefCloud<real_t> xyz, const real_t search_radius, const real_t small_radius, const uint32_t max_knn,
+        const size_t k_min, const std::string& backend)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (max_knn > n_points)
+    {
+        throw std::invalid_argument("max knn size is greater than the data point cloud size");
+    }
+    if (!(small_radius > real_t(0.0) && small_radius <= search_radius))
+    {
+        throw std::invalid_argument("small_radius should be in ]0, search_radius]");
+    }
+
+    const real_t                sq_search_radius = search_radius * search_radius;
+    const real_t                sq_small_radius  = small_radius * small_radius;
+    const std::array<real_t, 3> weights          = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    std::vector<uint32_t>       indices(n_points * max_knn);
+    std::vector<real_t>         sq_dist(n_points * max_knn);
+    std::vector<uint32_t>       counts(n_points);
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    const size_t id = point_id * max_knn;
+                    nanoflann::RKNNResultSet<real_t, uint32_t, uint32_t> result_set(max_knn, sq_search_radius);
+                    result_set.init(&indices[id], &sq_dist[id]);
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    counts[point_id] = static_cast<uint32_t>(result_set.size());
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    const size_t stride = max_knn;
+    return compute_normal_features<real_t>(
+        xyz, indices.data(),
+        [&counts, stride](const size_t i) { return std::pair<size_t, size_t>(i * stride, i * stride + counts[i]); },
+        [&sq_dist, sq_small_radius](const size_t, const size_t e) { return sq_dist[e] <= sq_small_radius; }, k_min);
+}
+
+}  // namespace pgeof
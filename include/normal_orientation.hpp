@@ -0,0 +1,291 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <utility>
+#include <vector>
+
+#include "pca.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+/**
+ * Orient normals towards a viewpoint (e.g. the scanner position), each normal being flipped if it points away from it.
+ *
+ * @param xyz the point cloud.
+ * @param normals the unoriented normals, aligned with xyz.
+ * @param viewpoint the position the normals should point to.
+ * @return the oriented normals in a (n_points, 3) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, 3>> orient_normals_viewpoint(
+    RefCloud<real_t> xyz, RefCloud<real_t> normals, const std::array<real_t, 3>& viewpoint)
+{
+    if (normals.rows() != xyz.rows()) { throw std::invalid_argument("normals should be aligned with xyz"); }
+
+    const size_t       n_points = static_cast<size_t>(xyz.rows());
+    real_t*            oriented = new real_t[3 * n_points];
+    nb::capsule        owner_oriented(oriented, [](void* p) noexcept { delete[] (real_t*)p; });
+    const Vec3<real_t> view(viewpoint[0], viewpoint[1], viewpoint[2]);
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            const real_t sign = normals.row(i).dot(view - xyz.row(i)) < real_t(0.0) ? real_t(-1.0) : real_t(1.0);
+            for (size_t d = 0; d < 3; ++d) { oriented[3 * i + d] = sign * normals(i, d); }
+        },
+        tf::StaticPartitioner(0));
+    executor.run(taskflow).get();
+
+    const size_t shape[2] = {n_points, 3};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, 3>>(oriented, 2, shape, owner_oriented);
+}
+
+/**
+ * Compute the minimum spanning forest of a neighborhood graph with the Borůvka algorithm.
+ *
+ * Each round, every component selects its lightest incident edge, in parallel over the edges: the weight and the
+ * position of an edge are packed in a 64 bits key, so that the selection is an atomic minimum and ties are broken
+ * consistently. The selected edges are then merged with a union-find. Edges are undirected: an edge (i, j) given in
+ * the neighbors of i only is incident to the components of i and j.
+ *
+ * @param n_points the number of nodes.
+ * @param nn the flattened neighbor indices, lower than n_points.
+ * @param nn_ptr [n_points+1] pointers wrt 'nn'.
+ * @param weight a functor giving the weight, >= 0, of the edge from node i to node j.
+ * @return the edges of the forest, as (i, j) pairs.
+ */
+template <typename Weight>
+static std::vector<std::pair<uint32_t, uint32_t>> minimum_spanning_forest(
+    const size_t n_points, const uint32_t* nn, const uint32_t* nn_ptr, Weight&& weight)
+{
+    constexpr uint64_t no_edge = std::numeric_limits<uint64_t>::max();
+
+    std::vector<uint32_t>                      parent(n_points);
+    std::vector<uint32_t>                      size(n_points, 1);
+    std::vector<uint32_t>                      component(n_points);
+    std::vector<std::atomic<uint64_t>>         best(n_points);
+    std::vector<std::pair<uint32_t, uint32_t>> forest;
+    std::iota(parent.begin(), parent.end(), uint32_t(0));
+
+    auto find = [&](uint32_t i)
+    {
+        while (parent[i] != i) { i = parent[i]; }
+        return i;
+    };
+
+    auto atomic_min = [](std::atomic<uint64_t>& target, const uint64_t key)
+    {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (key < current && !target.compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+    };
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    tf::Task     label = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            component[i] = find(static_cast<uint32_t>(i));
+            best[i].store(no_edge, std::memory_order_relaxed);
+        },
+        tf::StaticPartitioner(0));
+    tf::Task select = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            for (uint32_t e = nn_ptr[i]; e < nn_ptr[i + 1]; ++e)
+            {
+                const uint32_t ci = component[i];
+                const uint32_t cj = component[nn[e]];
+                if (ci == cj) continue;
+                // Weights are >= 0, so their float bits are ordered as the weights
+                const float w = static_cast<float>(weight(i, nn[e]));
+                uint32_t    bits;
+                std::memcpy(&bits, &w, sizeof(float));
+                const uint64_t key = (uint64_t(bits) << 32) | uint64_t(e);
+                atomic_min(best[ci], key);
+                atomic_min(best[cj], key);
+            }
+        },
+        tf::StaticPartitioner(0));
+    label.precede(select);
+
+    for (bool merged = true; merged;)
+    {
+        executor.run(taskflow).get();
+        merged = false;
+        for (size_t c = 0; c < n_points; ++c)
+        {
+            const uint64_t key = best[c].load(std::memory_order_relaxed);
+            if (key == no_edge) continue;
+            const uint32_t e = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+            const uint32_t i =
+                static_cast<uint32_t>(std::upper_bound(nn_ptr, nn_ptr + n_points + 1, e) - nn_ptr - 1);
+            const uint32_t j  = nn[e];
+            uint32_t       ri = find(i);
+            uint32_t       rj = find(j);
+            // Both components may have selected the same edge
+            if (ri == rj) continue;
+            if (size[ri] < size[rj]) { std::swap(ri, rj); }
+            parent[rj] = ri;
+            size[ri] += size[rj];
+            forest.emplace_back(i, j);
+            merged = true;
+        }
+    }
+    return forest;
+}
+
+/**
+ * Orient normals consistently by propagation over a neighborhood graph (Hoppe et al. 1992).
+ *
+ * The normals are propagated along the minimum spanning forest of the graph weighted by '1 - |n_i . n_j|', so that
+ * they first cross the edges between nearly parallel normals. The root of each connected component is its highest
+ * point, whose normal is oriented towards +z. The forest is traversed in breadth-first order, each level being
+ * processed in parallel, and each normal is flipped if it disagrees with the normal of its parent.
+ *
+ * @param xyz the point cloud.
+ * @param normals the unoriented normals, aligned with xyz.
+ * @param nn Integer 1D array. Flattened neighbor indices.
+ * @param nn_ptr [n_points+1] Integer 1D array. Pointers wrt 'nn'. The graph does not need to be symmetric.
+ * @return the oriented normals in a (n_points, 3) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, 3>> orient_normals_propagation(
+    RefCloud<real_t> xyz, RefCloud<real_t> normals, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+    nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr)
+{
+    if (normals.rows() != xyz.rows()) { throw std::invalid_argument("normals should be aligned with xyz"); }
+    if (nn_ptr.size() != static_cast<size_t>(xyz.rows()) + 1)
+    {
+        throw std::invalid_argument("nn_ptr should hold n_points + 1 pointers");
+    }
+    const size_t    n_points    = static_cast<size_t>(xyz.rows());
+    const uint32_t* nn_data     = nn.data();
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+    if (n_points >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many points to be indexed with uint32 indices");
+    }
+    if (nn_ptr_data[n_points] > nn.size()) { throw std::invalid_argument("nn_ptr is inconsistent with nn"); }
+    for (uint32_t e = 0; e < nn_ptr_data[n_points]; ++e)
+    {
+        if (nn_data[e] >= n_points)
+        {
+            throw std::invalid_argument("neighbor indices should be lower than the number of points");
+        }
+    }
+
+    const auto forest = minimum_spanning_forest(
+        n_points, nn_data, nn_ptr_data,
+        [&](const size_t i, const size_t j)
+        { return std::max(real_t(0.0), real_t(1.0) - std::abs(normals.row(i).dot(normals.row(j)))); });
+
+    // Adjacency of the forest, in CSR format
+    std::vector<uint32_t> tree_ptr(n_points + 1, 0);
+    std::vector<uint32_t> tree_nn(2 * forest.size());
+    for (const auto& [i, j] : forest)
+    {
+        ++tree_ptr[i + 1];
+        ++tree_ptr[j + 1];
+    }
+    std::partial_sum(tree_ptr.begin(), tree_ptr.end(), tree_ptr.begin());
+    {
+        std::vector<uint32_t> cursor(tree_ptr.begin(), tree_ptr.end() - 1);
+        for (const auto& [i, j] : forest)
+        {
+            tree_nn[cursor[i]++] = j;
+            tree_nn[cursor[j]++] = i;
+        }
+    }
+
+    // The root of each tree is its highest point
+    std::vector<uint32_t> root(n_points);
+    std::vector<uint8_t>  visited(n_points, 0);
+    std::vector<uint32_t> frontier;
+    std::vector<uint32_t> stack;
+    for (uint32_t i = 0; i < n_points; ++i)
+    {
+        if (visited[i]) continue;
+        uint32_t highest = i;
+        visited[i]       = 1;
+        stack.assign(1, i);
+        while (!stack.empty())
+        {
+            const uint32_t node = stack.back();
+            stack.pop_back();
+            if (xyz(node, 2) > xyz(highest, 2)) { highest = node; }
+            for (uint32_t e = tree_ptr[node]; e < tree_ptr[node + 1]; ++e)
+            {
+                if (!visited[tree_nn[e]])
+                {
+                    visited[tree_nn[e]] = 1;
+                    stack.push_back(tree_nn[e]);
+                }
+            }
+        }
+        frontier.push_back(highest);
+    }
+
+    real_t*                           oriented = new real_t[3 * n_points];
+    nb::capsule                       owner_oriented(oriented, [](void* p) noexcept { delete[] (real_t*)p; });
+    std::vector<std::atomic<uint8_t>> reached(n_points);
+    for (const uint32_t i : frontier)
+    {
+        const real_t sign = normals(i, 2) < real_t(0.0) ? real_t(-1.0) : real_t(1.0);
+        for (size_t d = 0; d < 3; ++d) { oriented[3 * i + d] = sign * normals(i, d); }
+        reached[i].store(1, std::memory_order_relaxed);
+    }
+
+    // Level-synchronous breadth-first traversal, the next level being appended through an atomic cursor
+    std::vector<uint32_t> next(n_points);
+    std::atomic<uint32_t> n_next{0};
+    tf::Executor          executor;
+    while (!frontier.empty())
+    {
+        n_next.store(0, std::memory_order_relaxed);
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(
+            size_t(0), frontier.size(), size_t(1),
+            [&](size_t f)
+            {
+                const uint32_t     i      = frontier[f];
+                const Vec3<real_t> normal = Eigen::Map<const Vec3<real_t>>(&oriented[3 * i]);
+                for (uint32_t e = tree_ptr[i]; e < tree_ptr[i + 1]; ++e)
+                {
+                    const uint32_t j = tree_nn[e];
+                    if (reached[j].exchange(1, std::memory_order_relaxed)) continue;
+                    const real_t sign = normal.dot(normals.row(j)) < real_t(0.0) ? real_t(-1.0) : real_t(1.0);
+                    for (size_t d = 0; d < 3; ++d) { oriented[3 * j + d] = sign * normals(j, d); }
+                    next[n_next.fetch_add(1, std::memory_order_relaxed)] = j;
+                }
+            },
+            tf::StaticPartitioner(0));
+        executor.run(taskflow).get();
+        frontier.assign(next.begin(), next.begin() + n_next.load(std::memory_order_relaxed));
+    }
+
+    const size_t shape[2] = {n_points, 3};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, 3>>(oriented, 2, shape, owner_oriented);
+}
+
+}  // namespace pgeof
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/variant.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <nanoflann.hpp>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+#include "nn_search.hpp"
+#include "pca.hpp"
+#include "search_index.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+// The inliers of a filter, either as a mask or as sorted indices
+using InliersResult =
+    std::variant<nb::ndarray<nb::numpy, bool, nb::ndim<1>>, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>>;
+
+// The inliers of a filter, and optionally the neighbors of the inliers in CSR format
+using OutlierFilterResult = std::tuple<
+    InliersResult, std::optional<nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>>,
+    std::optional<nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>>>;
+
+/**
+ * Gather the result of an outlier filter: the inliers, as a mask or as indices, and optionally the neighbors of the
+ * inliers, restricted to the inliers and renumbered as in 'xyz[inliers]'.
+ *
+ * @param inlier the inlier flag of each point.
+ * @param neighbors the neighbors of each point (the point itself excluded), in 'stride' sized rows, or nullptr.
+ * @param counts the number of neighbors of each point.
+ * @param stride the size of a row of 'neighbors'.
+ * @param return_indices whether the inliers are returned as indices rather than as a mask.
+ * @return the inliers, and the neighbors in CSR format if 'neighbors' is given (None otherwise), each point being its
+ * own first neighbor.
+ */
+static OutlierFilterResult make_outlier_filter_result(
+    const std::vector<uint8_t>& inlier, const uint32_t* neighbors, const uint32_t* counts, const size_t stride,
+    const bool return_indices)
+{
+    const size_t          n_points = inlier.size();
+    std::vector<uint32_t> new_id(n_points + 1, 0);
+    for (size_t i = 0; i < n_points; ++i) { new_id[i + 1] = new_id[i] + inlier[i]; }
+    const size_t n_inliers = new_id[n_points];
+
+    InliersResult inliers;
+    if (return_indices)
+    {
+        uint32_t*   indices = new uint32_t[n_inliers];
+        nb::capsule owner_indices(indices, [](void* p) noexcept { delete[] (uint32_t*)p; });
+        for (size_t i = 0; i < n_points; ++i)
+        {
+            if (inlier[i]) { indices[new_id[i]] = static_cast<uint32_t>(i); }
+        }
+        inliers = nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(indices, {n_inliers}, owner_indices);
+    }
+    else
+    {
+        bool*       mask = new bool[n_points];
+        nb::capsule owner_mask(mask, [](void* p) noexcept { delete[] (bool*)p; });
+        for (size_t i = 0; i < n_points; ++i) { mask[i] = inlier[i] != 0; }
+        inliers = nb::ndarray<nb::numpy, bool, nb::ndim<1>>(mask, {n_points}, owner_mask);
+    }
+    if (neighbors == nullptr) { return {inliers, std::nullopt, std::nullopt}; }
+
+    // Neighbors of the inliers, the outliers being removed from the neighborhoods
+    uint32_t*   nn_ptr = new uint32_t[n_inliers + 1];
+    nb::capsule owner_nn_ptr(nn_ptr, [](void* p) noexcept { delete[] (uint32_t*)p; });
+    nn_ptr[0] = 0;
+    for (size_t i = 0; i < n_points; ++i)
+    {
+        if (!inlier[i]) continue;
+        uint32_t        size = 1;
+        const uint32_t* row  = &neighbors[i * stride];
+        for (uint32_t r = 0; r < counts[i]; ++r) { size += inlier[row[r]]; }
+        nn_ptr[new_id[i] + 1] = nn_ptr[new_id[i]] + size;
+    }
+
+    const size_t n_edges = nn_ptr[n_inliers];
+    uint32_t*    nn      = new uint32_t[n_edges];
+    nb::capsule  owner_nn(nn, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            if (!inlier[i]) return;
+            uint32_t*       out = &nn[nn_ptr[new_id[i]]];
+            const uint32_t* row = &neighbors[i * stride];
+            *out++              = new_id[i];
+            for (uint32_t r = 0; r < counts[i]; ++r)
+            {
+                if (inlier[row[r]]) { *out++ = new_id[row[r]]; }
+            }
+        },
+        tf::StaticPartitioner(0));
+    executor.run(taskflow).get();
+
+    return {
+        inliers, nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(nn, {n_edges}, owner_nn),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(nn_ptr, {n_inliers + 1}, owner_nn_ptr)};
+}
+
+/**
+ * Statistical outlier removal (SOR): a point is an outlier if the mean distance to its k nearest neighbors is greater
+ * than 'mean + std_ratio * std', the mean and standard deviation being computed over all the points.
+ *
+ * The mean distance of each point is computed on the fly during a parallel kNN search, so no distance matrix is
+ * stored. The neighbors are only kept if they are returned, to compute features without searching them again.
+ *
+ * @param xyz the point cloud.
+ * @param k the number of neighbors of each point, the point itself excluded.
+ * @param std_ratio the number of standard deviations above the mean of the mean distances beyond which a point is an
+ * outlier.
+ * @param return_indices whether the inliers are returned as indices rather than as a mask.
+ * @param return_neighbors whether the neighbors of the inliers are returned.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return a tuple: the inliers, as a boolean mask of size n_points or as sorted indices, and if 'return_neighbors' the
+ * 'nn' and 'nn_ptr' CSR arrays of the inliers (None otherwise), see make_outlier_filter_result.
+ */
+template <typename real_t>
+static OutlierFilterResult statistical_outlier_filter(
+    RefCloud<real_t> xyz, const uint32_t k, const real_t std_ratio, const bool return_indices,
+    const bool return_neighbors, const std::string& backend)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (k == 0) { throw std::invalid_argument("k should be > 0"); }
+    if (k >= n_points) { throw std::invalid_argument("k should be lower than the number of points"); }
+    if (n_points >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many points to be indexed with uint32 indices");
+    }
+
+    const std::array<real_t, 3> weights = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    std::vector<real_t>         mean_distance(n_points);
+    std::vector<uint32_t>       neighbors(return_neighbors ? n_points * k : 0);
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    thread_local std::vector<uint32_t> indices;
+                    thread_local std::vector<real_t>   sq_dist;
+                    indices.resize(k);
+                    sq_dist.resize(k);
+                    nanoflann::KNNResultSet<real_t, uint32_t, uint32_t> result_set(k);
+                    result_set.init(indices.data(), sq_dist.data());
+                    find_neighbors(index, result_set, xyz.row(point_id).data(), true, point_id);
+
+                    real_t sum = real_t(0.0);
+                    for (uint32_t r = 0; r < k; ++r) { sum += std::sqrt(sq_dist[r]); }
+                    mean_distance[point_id] = sum / real_t(k);
+                    if (return_neighbors) { std::copy(indices.begin(), indices.end(), &neighbors[point_id * k]); }
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    double sum    = 0.0;
+    double sum_sq = 0.0;
+    for (const real_t d : mean_distance)
+    {
+        sum += d;
+        sum_sq += double(d) * double(d);
+    }
+    const double mean      = sum / double(n_points);
+    const double std       = std::sqrt(std::max(0.0, sum_sq / double(n_points) - mean * mean));
+    const double threshold = mean + double(std_ratio) * std;
+
+    std::vector<uint8_t> inlier(n_points);
+    for (size_t i = 0; i < n_points; ++i) { inlier[i] = double(mean_distance[i]) <= threshold; }
+
+    const std::vector<uint32_t> counts(return_neighbors ? n_points : 0, k);
+    return make_outlier_filter_result(
+        inlier, return_neighbors ? neighbors.data() : nullptr, counts.data(), k, return_indices);
+}
+
+/**
+ * Radius outlier removal: a point is an outlier if it has less than 'min_neighbors' neighbors (itself excluded) within
+ * a radius.
+ *
+ * The neighbors are counted during a parallel radius search, which stops as soon as 'min_neighbors' are found. If the
+ * neighbors are returned, up to 'max_knn' of them are kept instead, to compute features without searching them again.
+ *
+ * @param xyz the point cloud.
+ * @param search_radius the search radius.
+ * @param min_neighbors the minimum number of neighbors of an inlier.
+ * @param return_indices whether the inliers are returned as indices rather than as a mask.
+ * @param return_neighbors whether the neighbors of the inliers are returned.
+ * @param max_knn the maximum number of neighbors kept per point (itself excluded) if they are returned, at least
+ * min_neighbors.
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend).
+ * @return a tuple: the inliers, as a boolean mask of size n_points or as sorted indices, and if 'return_neighbors' the
+ * 'nn' and 'nn_ptr' CSR arrays of the inliers (None otherwise), see make_outlier_filter_result.
+ */
+template <typename real_t>
+static OutlierFilterResult radius_outlier_filter(
+    RefCloud<real_t> xyz, const real_t search_radius, const uint32_t min_neighbors, const bool return_indices,
+    const bool return_neighbors, const uint32_t max_knn, const std::string& backend)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (return_neighbors && max_knn < min_neighbors)
+    {
+        throw std::invalid_argument("max_knn should be >= min_neighbors");
+    }
+    if (n_points >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many points to be indexed with uint32 indices");
+    }
+
+    const real_t                sq_search_radius = search_radius * search_radius;
+    const std::array<real_t, 3> weights          = {real_t(1.0), real_t(1.0), real_t(1.0)};
+    const size_t                stride           = return_neighbors ? max_knn : 0;
+    std::vector<uint8_t>        inlier(n_points);
+    std::vector<uint32_t>       neighbors(n_points * stride);
+    std::vector<uint32_t>       counts(return_neighbors ? n_points : 0);
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            tf::Executor executor;
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t point_id)
+                {
+                    size_t count;
+                    if (return_neighbors)
+                    {
+                        thread_local std::vector<real_t> sq_dist;
+                        sq_dist.resize(max_knn);
+                        nanoflann::RKNNResultSet<real_t, uint32_t, uint32_t> result_set(max_knn, sq_search_radius);
+                        result_set.init(&neighbors[point_id * stride], sq_dist.data());
+                        find_neighbors(index, result_set, xyz.row(point_id).data(), true, point_id);
+                        count            = result_set.size();
+                        counts[point_id] = static_cast<uint32_t>(count);
+                    }
+                    else
+                    {
+                        CountResultSet<real_t> result_set(min_neighbors, sq_search_radius);
+                        if (min_neighbors > 0)
+                        {
+                            find_neighbors(index, result_set, xyz.row(point_id).data(), true, point_id);
+                        }
+                        count = result_set.size();
+                    }
+                    inlier[point_id] = count >= min_neighbors;
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    return make_outlier_filter_result(
+        inlier, return_neighbors ? neighbors.data() : nullptr, counts.data(), stride, return_indices);
+}
+
+}  // namespace pgeof
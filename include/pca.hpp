@@ -24,6 +24,8 @@ template <typename real_t>
 using MatrixCloud = Eigen::Matrix<real_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
 template <typename real_t>
 using DRefMatrixCloud = nb::DRef<const MatrixCloud<real_t>>;
+template <typename real_t>
+using RefMatrixCloud = Eigen::Ref<const MatrixCloud<real_t>>;
 
 // epsilon definition, for now same for float an double
 // the eps is meant to stabilize the division when the cloud's 3rd eigenvalue is near 0
@@ -59,22 +61,22 @@ typedef enum EFeatureID
     Curvature,
     K_optimal,
     Verticality,  // this is the "classical" verticality
-    Eigentropy
+    Eigentropy,
+    PrincipalCurvature1,  // Curvatures of a quadric fitted on the neighbors, see quadric.hpp
+    PrincipalCurvature2,
+    MeanCurvature,
+    GaussianCurvature
 } EFeatureID;
 
 /**
- * Given A point cloud compute a PCAResult
+ * Given a (3, 3) covariance matrix compute a PCAResult
  *
- * @param cloud the point cloud
+ * @param cov the covariance matrix
  * @returns A PCAResult
  */
 template <typename real_t>
-static inline PCAResult<real_t> pca_from_pointcloud(const PointCloud<real_t>& cloud)
+static inline PCAResult<real_t> pca_from_covariance(const Eigen::Matrix<real_t, 3, 3>& cov)
 {
-    // Compute the (3, 3) covariance matrix
-    const PointCloud<real_t>          centered_cloud = cloud.rowwise() - cloud.colwise().mean();
-    const Eigen::Matrix<real_t, 3, 3> cov = (centered_cloud.transpose() * centered_cloud) / real_t(cloud.rows());
-
     // Compute the eigenvalues and eigenvectors of the covariance
     Eigen::SelfAdjointEigenSolver<Eigen::Matrix<real_t, 3, 3>> es(cov);
 
@@ -102,6 +104,98 @@ static inline PCAResult<real_t> pca_from_pointcloud(const PointCloud<real_t>& cl
     return {val, v0, v1, v2};
 };
 
+/**
+ * Given A point cloud compute a PCAResult
+ *
+ * @param cloud the point cloud
+ * @returns A PCAResult
+ */
+template <typename real_t>
+static inline PCAResult<real_t> pca_from_pointcloud(const PointCloud<real_t>& cloud)
+{
+    // Compute the (3, 3) covariance matrix
+    const PointCloud<real_t>          centered_cloud = cloud.rowwise() - cloud.colwise().mean();
+    const Eigen::Matrix<real_t, 3, 3> cov = (centered_cloud.transpose() * centered_cloud) / real_t(cloud.rows());
+    return pca_from_covariance(cov);
+};
+
+/**
+ * Given A point cloud and an accessor over a subset of its point indices, compute a PCAResult
+ *
+ * Unlike pca_from_pointcloud, the neighbors' coordinates are not gathered into an intermediate cloud:
+ * the mean and the covariance are accumulated in two passes directly from xyz, so no allocation occurs.
+ *
+ * @param xyz the point cloud
+ * @param k_nn the number of points in the subset
+ * @param index_of a callable returning the index (in xyz) of the i-th point of the subset, for i in [0, k_nn)
+ * @returns A PCAResult
+ */
+template <typename real_t, typename IndexAccessor>
+static inline PCAResult<real_t> pca_from_indices(RefCloud<real_t> xyz, const size_t k_nn, IndexAccessor&& index_of)
+{
+    Vec3<real_t> mean = Vec3<real_t>::Zero();
+    for (size_t i = 0; i < k_nn; ++i) { mean += xyz.row(static_cast<Eigen::Index>(index_of(i))); }
+    mean /= real_t(k_nn);
+
+    Eigen::Matrix<real_t, 3, 3> cov = Eigen::Matrix<real_t, 3, 3>::Zero();
+    for (size_t i = 0; i < k_nn; ++i)
+    {
+        const Vec3<real_t> centered = xyz.row(static_cast<Eigen::Index>(index_of(i))) - mean;
+        cov.noalias() += centered.transpose() * centered;
+    }
+    cov /= real_t(k_nn);
+    return pca_from_covariance(cov);
+};
+
+/**
+ * Running first and second order moments of a growing set of points.
+ *
+ * Points are expressed relatively to an origin (typically the query point) so the moments remain well conditioned
+ * for large coordinates. It allows computing the PCA of nested neighborhoods (e.g. the prefixes of a
+ * distance-sorted neighbor list) incrementally, each point being visited only once.
+ *
+ * The moments are accumulated in double precision whatever real_t: the covariance is obtained by subtracting two
+ * moments of similar magnitude, which would cancel most of the digits of the smallest eigenvalue of flat
+ * neighborhoods in single precision.
+ */
+template <typename real_t>
+struct PointMoments
+{
+    Vec3<real_t>       origin;
+    Eigen::RowVector3d sum    = Eigen::RowVector3d::Zero();
+    Eigen::Matrix3d    sum_sq = Eigen::Matrix3d::Zero();
+    size_t             count  = 0;
+
+    explicit PointMoments(const Vec3<real_t>& origin) : origin(origin) {}
+
+    template <typename Derived>
+    void add(const Eigen::MatrixBase<Derived>& point)
+    {
+        const Eigen::RowVector3d centered = (point - origin).template cast<double>();
+        sum += centered;
+        sum_sq.noalias() += centered.transpose() * centered;
+        ++count;
+    }
+
+    Eigen::Matrix<real_t, 3, 3> covariance() const
+    {
+        const Eigen::RowVector3d mean = sum / double(count);
+        return (sum_sq / double(count) - mean.transpose() * mean).template cast<real_t>();
+    }
+};
+
+/**
+ * Given the moments of a set of points compute a PCAResult
+ *
+ * @param moments the accumulated moments, it should hold at least one point
+ * @returns A PCAResult
+ */
+template <typename real_t>
+static inline PCAResult<real_t> pca_from_moments(const PointMoments<real_t>& moments)
+{
+    return pca_from_covariance<real_t>(moments.covariance());
+};
+
 /**
  * Given A point cloud and a CSR definition of the neighboring information for each point, compute a PCAResult
  *
@@ -154,6 +248,46 @@ static inline real_t compute_eigentropy(const PCAResult<real_t>& pca)
         e(2) * std::log(e(2) + epsilon<real_t>));
 };
 
+/**
+ * Given a PCA result compute the dimensionality entropy
+ *
+ * Like the eigentropy, it is used as a neighborhood size selection criterion, the optimal neighborhood being the one
+ * where one of the 1D, 2D or 3D behaviors dominates the others.
+ *
+ * @param pca PCAResult
+ * @return the dimensionality entropy
+ */
+template <typename real_t>
+static inline real_t compute_dimensionality_entropy(const PCAResult<real_t>& pca)
+{
+    // Compute the dimensionality entropy as defined in:
+    // https://www.isprs.org/proceedings/XXXVIII/5-W12/Papers/ls2011_submission_40.pdf
+    const real_t val0      = std::sqrt(pca.val(0));
+    const real_t val1      = std::sqrt(pca.val(1));
+    const real_t val2      = std::sqrt(pca.val(2));
+    const real_t val0_fact = real_t(1.0) / (val0 + epsilon<real_t>);
+    const real_t a1d       = (val0 - val1) * val0_fact;
+    const real_t a2d       = (val1 - val2) * val0_fact;
+    const real_t a3d       = val2 * val0_fact;
+    return (
+        -a1d * std::log(a1d + epsilon<real_t>) - a2d * std::log(a2d + epsilon<real_t>) -
+        a3d * std::log(a3d + epsilon<real_t>));
+};
+
+/**
+ * Given a PCA result compute the surface variation (i.e. the change of curvature)
+ *
+ * @param pca PCAResult
+ * @return the surface variation
+ */
+template <typename real_t>
+static inline real_t compute_surface_variation(const PCAResult<real_t>& pca)
+{
+    // Compute the surface variation as defined in:
+    // https://doi.org/10.1109/VISUAL.2002.1183771
+    return pca.val(2) / (pca.val.sum() + epsilon<real_t>);
+};
+
 /**
  * Given a PCA result compute a full set of feature (the initial set of feature r)
  *
@@ -5,21 +5,26 @@
 #include <nanobind/ndarray.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdio>
 #include <iostream>
 #include <limits>
+#include <optional>
+#include <string>
 #include <taskflow/algorithm/for_each.hpp>
 #include <taskflow/taskflow.hpp>
 #include <vector>
 
+#include "neighborhood_statistics.hpp"
+#include "nn_search.hpp"
 #include "pca.hpp"
+#include "quadric.hpp"
 
 namespace nb = nanobind;
 
 namespace pgeof
 {
-
 namespace log
 {
 /**
@@ -210,10 +215,64 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1, static_cast<nb::ssize_t>
         features, 3, shape, owner_features);
 }
 
+// Strategy used to sweep the candidate neighborhood sizes when searching for the optimal neighborhood
+typedef enum EOptimalSearch
+{
+    Exhaustive = 0,  // every candidate is evaluated
+    CoarseToFine,  // a coarse subset of the candidates is evaluated, then refined around the best one
+    LogSpaced  // only log-spaced candidates are evaluated
+} EOptimalSearch;
+
+/**
+ * Convert the name of an optimal neighborhood search strategy into a EOptimalSearch.
+ *
+ * @param search one of 'exhaustive', 'coarse_to_fine' or 'log'
+ * @return the corresponding EOptimalSearch
+ */
+static EOptimalSearch optimal_search_from_string(const std::string& search)
+{
+    if (search == "exhaustive") { return EOptimalSearch::Exhaustive; }
+    if (search == "coarse_to_fine") { return EOptimalSearch::CoarseToFine; }
+    if (search == "log") { return EOptimalSearch::LogSpaced; }
+    throw std::invalid_argument("search should be one of 'exhaustive', 'coarse_to_fine' or 'log'");
+}
+
+/**
+ * Fill the list of candidate neighborhood sizes of an optimal neighborhood search.
+ *
+ * The candidates are k0, every multiple of k_step in ]k0, k_nn[ and k_nn. With EOptimalSearch::LogSpaced, only
+ * the candidates growing by a factor of at least 2^(1/4) from the previous one are kept (and k_nn).
+ *
+ * @param[in] k0 the smallest candidate
+ * @param[in] k_nn the largest candidate
+ * @param[in] k_step the step between two candidates
+ * @param[in] search the search strategy
+ * @param[out] candidates the candidate neighborhood sizes, in ascending order
+ */
+static void fill_optimal_candidates(
+    const size_t k0, const size_t k_nn, const size_t k_step, const EOptimalSearch search,
+    std::vector<size_t>& candidates)
+{
+    constexpr double log_growth = 1.189207115002721;  // 2^(1/4), i.e. 4 candidates per octave
+
+    candidates.clear();
+    candidates.push_back(k0);
+    for (size_t k = (k0 / k_step + 1) * k_step; k < k_nn; k += k_step)
+    {
+        if (search == EOptimalSearch::LogSpaced && double(k) < log_growth * double(candidates.back())) continue;
+        candidates.push_back(k);
+    }
+    if (k_nn > k0) { candidates.push_back(k_nn); }
+}
+
 /**
  * Compute a set of geometric features for a point cloud using the optimal neighborhood selection described in
  * http://lareg.ensg.eu/labos/matis/pdf/articles_revues/2015/isprs_wjhm_15.pdf
  *
+ * Neighbors are expected to be sorted by increasing distance, the neighborhoods of the candidate sizes are thus
+ * prefixes of each other. The exhaustive sweep computes the two-pass PCA of each candidate, the other sweeps obtain it
+ * by accumulating the points' moments incrementally.
+ *
  *  * The following features are computed:
  * - linearity
  * - planarity
@@ -238,6 +297,9 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1, static_cast<nb::ssize_t>
  * @param k_min_search Minimum neighborhood size at which to start when searching for the optimal neighborhood size for
  each point. It is advised to use a value of 10 or higher, for geometric features robustness.
  * @param verbose Whether computation progress should be printed out
+ * @param search the candidates sweep strategy. 'exhaustive' evaluates every candidate, 'coarse_to_fine' evaluates
+ * about sqrt(n_candidates) evenly spaced candidates then every candidate between the neighbors of the best one, 'log'
+ * evaluates log-spaced candidates only. The two last strategies trade exactness for fewer eigen decompositions.
  * @return Geometric features associated with each point's neighborhood in a (num_points, features_count) nd::array
  */
 template <typename real_t, const size_t feature_count = 12>
@@ -245,9 +307,11 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fea
     compute_geometric_features_optimal(
         RefCloud<real_t> xyz, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
         nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr, const uint32_t k_min, const uint32_t k_step,
-        const uint32_t k_min_search, const bool verbose)
+        const uint32_t k_min_search, const bool verbose, const std::string& search)
 {
     if (k_min < 1 && k_min_search < 1) { throw std::invalid_argument("k_min and k_min_search should be > 1"); }
+    if (k_step < 1) { throw std::invalid_argument("k_step should be > 1"); }
+    const EOptimalSearch search_strategy = optimal_search_from_string(search);
     // Each point can be treated in parallel
     const size_t    n_points    = nn_ptr.size() - 1;  // number of points is not determined by xyz
     size_t          s_point     = 0;
@@ -269,34 +333,90 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fea
             const size_t k_nn = static_cast<size_t>(nn_ptr_data[i_point + 1] - nn_ptr_data[i_point]);
 
             // Process only if the cloud has the required number of point
-            if (k_nn >= k_min && k_nn >= k_min_search)
+            if (k_nn < k_min || k_nn < k_min_search || k_nn == 0) return;
+
+            const size_t    k0 = std::min(std::max(static_cast<size_t>(k_min), static_cast<size_t>(k_min_search)), k_nn);
+            const uint32_t* neighbors = &nn_data[nn_ptr_data[i_point]];
+
+            thread_local std::vector<size_t> candidates;
+            fill_optimal_candidates(k0, k_nn, k_step, search_strategy, candidates);
+
+            PCAResult<real_t> pca_optimal;
+            real_t            eigenentropy_optimal = real_t(1.0);
+            size_t            k_optimal            = 0;
+
+            // Accumulate the neighbors' moments up to the k-th neighbor
+            const auto grow = [&](PointMoments<real_t>& moments, const size_t k)
             {
-                size_t k0 = std::min(std::max(static_cast<size_t>(k_min), static_cast<size_t>(k_min_search)), k_nn);
+                for (size_t i_nei = moments.count; i_nei < k; ++i_nei) { moments.add(xyz.row(neighbors[i_nei])); }
+            };
+            // Keep track of the optimal neighborhood size with the lowest eigenentropy. Ties are resolved towards the
+            // smallest neighborhood, as in an exhaustive sweep
+            const auto evaluate = [&](const PCAResult<real_t>& pca, const size_t k)
+            {
+                const real_t eigenentropy = compute_eigentropy(pca);
+                if ((k_optimal == 0) || (eigenentropy < eigenentropy_optimal) ||
+                    (eigenentropy == eigenentropy_optimal && k < k_optimal))
+                {
+                    eigenentropy_optimal = eigenentropy;
+                    k_optimal            = k;
+                    pca_optimal          = pca;
+                }
+            };
 
-                PCAResult<real_t> pca_optimal;
-                real_t            eigenentropy_optimal = real_t(1.0);
-                size_t            k_optimal            = k_nn;
-                for (size_t k = k0; k <= k_nn; ++k)
+            PointMoments<real_t> moments(xyz.row(neighbors[0]));
+            if (search_strategy == EOptimalSearch::Exhaustive)
+            {
+                // Each candidate gets the two-pass PCA of its neighborhood, as without a search strategy
+                for (const size_t k : candidates)
                 {
-                    // Only evaluate the neighborhood's PCA every 'k_step'
-                    // and at the boundary values: k0 and k_nn
-                    if ((k > k0) && (k % k_step != 0) && (k != k_nn)) { continue; }
-
-                    const PCAResult<real_t> pca          = pca_from_neighborhood(xyz, nn_data, nn_ptr_data, i_point, k);
-                    const real_t            eigenentropy = compute_eigentropy(pca);
-                    // Keep track of the optimal neighborhood size with the
-                    // lowest eigenentropy
-                    if ((k == k0) || (eigenentropy < eigenentropy_optimal))
-                    {
-                        eigenentropy_optimal = eigenentropy;
-                        k_optimal            = k;
-                        pca_optimal          = pca;
-                    }
+                    evaluate(pca_from_neighborhood(xyz, nn_data, nn_ptr_data, i_point, k), k);
                 }
-                compute_features(pca_optimal, &features[i_point * feature_count]);
-                // Add best nn
-                features[i_point * feature_count + 11] = real_t(k_optimal);
             }
+            else if (search_strategy == EOptimalSearch::LogSpaced)
+            {
+                for (const size_t k : candidates)
+                {
+                    grow(moments, k);
+                    evaluate(pca_from_moments(moments), k);
+                }
+            }
+            else
+            {
+                // Coarse sweep, the moments are saved at each coarse candidate to resume the refinement from there
+                thread_local std::vector<size_t>               coarse;
+                thread_local std::vector<PointMoments<real_t>> coarse_moments;
+                const size_t n_candidates = candidates.size();
+                const size_t stride       = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n_candidates))));
+                coarse.clear();
+                coarse_moments.clear();
+                for (size_t i = 0; i < n_candidates; i += stride) { coarse.push_back(i); }
+                if (coarse.back() != n_candidates - 1) { coarse.push_back(n_candidates - 1); }
+
+                size_t j_best = 0;
+                for (size_t j = 0; j < coarse.size(); ++j)
+                {
+                    grow(moments, candidates[coarse[j]]);
+                    coarse_moments.push_back(moments);
+                    const size_t k_before = k_optimal;
+                    evaluate(pca_from_moments(moments), moments.count);
+                    if (k_optimal != k_before) { j_best = j; }
+                }
+
+                // Fine sweep between the coarse candidates surrounding the best one
+                const size_t         j_low   = j_best > 0 ? j_best - 1 : 0;
+                const size_t         i_high  = j_best + 1 < coarse.size() ? coarse[j_best + 1] : coarse[j_best];
+                PointMoments<real_t> refined = coarse_moments[j_low];
+                for (size_t i = coarse[j_low] + 1; i < i_high; ++i)
+                {
+                    grow(refined, candidates[i]);
+                    if (i != coarse[j_best]) { evaluate(pca_from_moments(refined), refined.count); }
+                }
+            }
+
+            compute_features(pca_optimal, &features[i_point * feature_count]);
+            // Add best nn
+            features[i_point * feature_count + 11] = real_t(k_optimal);
         },
         tf::StaticPartitioner(0));
 
@@ -309,6 +429,156 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fea
         features, 2, shape, owner_features);
 }
 
+// Criterion minimized by the optimal neighborhood selection
+typedef enum EOptimalCriterion
+{
+    EigentropyCriterion = 0,  // Eigenentropy, Weinmann et al., 2015
+    DimensionalityCriterion,  // Dimensionality entropy, Demantké et al., 2011
+    CurvatureStabilityCriterion  // Change of surface variation between two consecutive candidates
+} EOptimalCriterion;
+
+/**
+ * Compute a set of geometric features for a point cloud using the optimal neighborhood selection, evaluating several
+ * selection criteria in the same sweep over the candidate neighborhood sizes.
+ *
+ * The neighborhoods' moments and PCA are shared by all the criteria. The optimal neighborhood size is returned for
+ * each criterion, while the features are computed at the optimal neighborhood of the first criterion.
+ *
+ * @param xyz The point cloud
+ * @param nn Integer 1D array. Flattened neighbor indices. Make sure those are all positive,
+ *  '-1' indices will either crash or silently compute incorrect features.
+ * @param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'. More specifically, the neighbors of point 'i'
+ *  are 'nn[nn_ptr[i]:nn_ptr[i + 1]]'.
+ * @param criteria the list of criteria to evaluate. See pgeof::EOptimalCriterion
+ * @param k_min Minimum number of neighbors to consider for features computation. If a point has less,
+ * its features and optimal sizes will be a set of '0' values.
+ * @param k_step Step size to take when searching for the optimal neighborhood
+ * @param k_min_search Minimum neighborhood size at which to start when searching for the optimal neighborhood size
+ * @param verbose Whether computation progress should be printed out
+ * @param search the candidates sweep strategy, 'exhaustive' or 'log'. Refining the sweep around the best candidate
+ * ('coarse_to_fine') is criterion dependent, hence not supported.
+ * @return a pair of nd::array, the geometric features in a (num_points, features_count) nd::array, computed with the
+ * first criterion, and the optimal neighborhood size of each criterion in a (num_points, n_criteria) nd::array.
+ */
+template <typename real_t, const size_t feature_count = 12>
+static std::pair<
+    nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(feature_count)>>,
+    nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>>
+    compute_geometric_features_optimal_criteria(
+        RefCloud<real_t> xyz, nb::ndarray<const uint32_t, nb::ndim<1>> nn,
+        nb::ndarray<const uint32_t, nb::ndim<1>> nn_ptr, const std::vector<EOptimalCriterion>& criteria,
+        const uint32_t k_min, const uint32_t k_step, const uint32_t k_min_search, const bool verbose,
+        const std::string& search)
+{
+    if (k_min < 1 && k_min_search < 1) { throw std::invalid_argument("k_min and k_min_search should be > 1"); }
+    if (k_step < 1) { throw std::invalid_argument("k_step should be > 1"); }
+    if (criteria.empty()) { throw std::invalid_argument("at least one criterion should be given"); }
+    const EOptimalSearch search_strategy = optimal_search_from_string(search);
+    if (search_strategy == EOptimalSearch::CoarseToFine)
+    {
+        throw std::invalid_argument("search should be 'exhaustive' or 'log' when evaluating several criteria");
+    }
+    const size_t    n_points    = nn_ptr.size() - 1;  // number of points is not determined by xyz
+    const size_t    n_criteria  = criteria.size();
+    size_t          s_point     = 0;
+    const uint32_t* nn_data     = nn.data();
+    const uint32_t* nn_ptr_data = nn_ptr.data();
+
+    real_t*     features = new real_t[n_points * feature_count];
+    nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
+    std::fill(features, features + n_points * feature_count, real_t(0.0));
+
+    uint32_t*   k_optimal = new uint32_t[n_points * n_criteria];
+    nb::capsule owner_k_optimal(k_optimal, [](void* k) noexcept { delete[] (uint32_t*)k; });
+    std::fill(k_optimal, k_optimal + n_points * n_criteria, uint32_t(0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(
+        size_t(0), size_t(n_points), size_t(1),
+        [&](size_t i_point)
+        {
+            if (verbose) log::progress(s_point, n_points);
+
+            // Recover the points' total number of neighbors
+            const size_t k_nn = static_cast<size_t>(nn_ptr_data[i_point + 1] - nn_ptr_data[i_point]);
+
+            // Process only if the cloud has the required number of point
+            if (k_nn < k_min || k_nn < k_min_search || k_nn == 0) return;
+
+            const size_t    k0 = std::min(std::max(static_cast<size_t>(k_min), static_cast<size_t>(k_min_search)), k_nn);
+            const uint32_t* neighbors = &nn_data[nn_ptr_data[i_point]];
+
+            thread_local std::vector<size_t> candidates;
+            thread_local std::vector<real_t> criterion_optimal;
+            fill_optimal_candidates(k0, k_nn, k_step, search_strategy, candidates);
+            criterion_optimal.assign(n_criteria, std::numeric_limits<real_t>::max());
+
+            uint32_t*            point_k_optimal = &k_optimal[i_point * n_criteria];
+            PCAResult<real_t>    pca_optimal;
+            real_t               surface_variation_previous = real_t(0.);
+            PointMoments<real_t> moments(xyz.row(neighbors[0]));
+            for (const size_t k : candidates)
+            {
+                PCAResult<real_t> pca;
+                if (search_strategy == EOptimalSearch::Exhaustive)
+                {
+                    pca = pca_from_neighborhood(xyz, nn_data, nn_ptr_data, i_point, k);
+                }
+                else
+                {
+                    for (size_t i_nei = moments.count; i_nei < k; ++i_nei) { moments.add(xyz.row(neighbors[i_nei])); }
+                    pca = pca_from_moments(moments);
+                }
+                const real_t surface_variation = compute_surface_variation(pca);
+                for (size_t i_criterion = 0; i_criterion < n_criteria; ++i_criterion)
+                {
+                    real_t criterion;
+                    switch (criteria[i_criterion])
+                    {
+                        case EOptimalCriterion::EigentropyCriterion:
+                            criterion = compute_eigentropy(pca);
+                            break;
+                        case EOptimalCriterion::DimensionalityCriterion:
+                            criterion = compute_dimensionality_entropy(pca);
+                            break;
+                        case EOptimalCriterion::CurvatureStabilityCriterion:
+                            // The first candidate has no predecessor, it is only kept if it is the only candidate
+                            criterion = k == k0 ? std::numeric_limits<real_t>::max()
+                                                : std::abs(surface_variation - surface_variation_previous);
+                            break;
+                        default:
+                            criterion = real_t(0.);
+                            break;
+                    }
+                    // Keep track of the optimal neighborhood size with the lowest criterion
+                    if ((k == k0) || (criterion < criterion_optimal[i_criterion]))
+                    {
+                        criterion_optimal[i_criterion] = criterion;
+                        point_k_optimal[i_criterion]   = static_cast<uint32_t>(k);
+                        if (i_criterion == 0) { pca_optimal = pca; }
+                    }
+                }
+                surface_variation_previous = surface_variation;
+            }
+            compute_features(pca_optimal, &features[i_point * feature_count]);
+            // Add best nn
+            features[i_point * feature_count + 11] = real_t(point_k_optimal[0]);
+        },
+        tf::StaticPartitioner(0));
+
+    executor.run(taskflow).get();
+
+    if (verbose) log::flush();
+
+    const size_t shape_features[2]  = {n_points, feature_count};
+    const size_t shape_k_optimal[2] = {n_points, n_criteria};
+    return {
+        nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(feature_count)>>(
+            features, 2, shape_features, owner_features),
+        nb::ndarray<nb::numpy, uint32_t, nb::ndim<2>>(k_optimal, 2, shape_k_optimal, owner_k_optimal)};
+}
+
 /**
  * Compute a selected set of geometric features for a point cloud via radius search.
  *
@@ -320,20 +590,36 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(fea
  * @param max_knn the maximum number of neighbors to fetch inside the radius. The central point is included. Fixing a
  * reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
  * @param selected_features the list of selected features. See pgeof::EFeatureID
- * @return Geometric features associated with each point's neighborhood in a (num_points, features_count) nd::array
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend)
+ * @param weights the weight of each axis in the square distances of the search (see with_search_index). Features
+ * are computed in the original coordinates
+ * @param attributes optional [n_points, n_channels] per-point attributes, whose statistics over each neighborhood are
+ * computed from the same search (see compute_neighborhood_statistics)
+ * @param statistics the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'
+ * @return Geometric features associated with each point's neighborhood in a (num_points, features_count) nd::array,
+ * followed by the statistics of the attributes (statistic by statistic, each one over all the channels) if they are
+ * given
  */
 template <typename real_t>
 static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1>> compute_geometric_features_selected(
     RefCloud<real_t> xyz, const real_t search_radius, const uint32_t max_knn,
-    const std::vector<EFeatureID>& selected_features)
+    const std::vector<EFeatureID>& selected_features, const std::string& backend,
+    const std::array<real_t, 3>& weights,
+    std::optional<nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>> attributes,
+    const std::vector<std::string>&                                     statistics)
 {
-    using kd_tree_t = nanoflann::KDTreeEigenMatrixAdaptor<RefCloud<real_t>, 3, nanoflann::metric_L2_Simple>;
+    using result_item_t = nanoflann::ResultItem<Eigen::Index, real_t>;
     // TODO: where knn < num of points
 
-    kd_tree_t          kd_tree(3, xyz, 10, 0);
-    const size_t       feature_count    = selected_features.size();
-    const Eigen::Index n_points         = xyz.rows();
-    real_t             sq_search_radius = search_radius * search_radius;
+    const Eigen::Index      n_points         = xyz.rows();
+    real_t                  sq_search_radius = search_radius * search_radius;
+    std::vector<EStatistic> stats;
+    const size_t            statistics_count =
+        prepare_fused_statistics(attributes, statistics, static_cast<size_t>(n_points), stats);
+    const size_t n_channels      = attributes ? attributes->shape(1) : 0;
+    const size_t geometric_count = selected_features.size();
+    const size_t feature_count   = geometric_count + statistics_count;
+    const bool   with_quadric    = has_quadric_features(selected_features);
 
     real_t*     features = (real_t*)calloc(n_points * feature_count, sizeof(real_t));
     nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
@@ -341,36 +627,398 @@ static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1>> compute_geometric_featu
     tf::Executor executor;
     tf::Taskflow taskflow;
 
-    taskflow.for_each_index(
-        Eigen::Index(0), n_points, Eigen::Index(1),
-        [&](Eigen::Index point_id)
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
         {
-            std::vector<nanoflann::ResultItem<Eigen::Index, real_t>> result_set;
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    // Neighbors buffer reused by all the queries handled by a worker, its capacity grows up to max_knn
+                    thread_local std::vector<result_item_t> neighbors;
 
-            nanoflann::RadiusResultSet<real_t, Eigen::Index> radius_result_set(sq_search_radius, result_set);
-            const auto                                       num_found =
-                kd_tree.index_->radiusSearchCustomCallback(xyz.row(point_id).data(), radius_result_set);
+                    // Only the max_knn closest points within the radius are kept
+                    BoundedHeapResultSet<real_t, Eigen::Index> result_set(neighbors, max_knn, sq_search_radius);
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    const size_t num_nn = result_set.size();
 
-            // not enough point, no feature computation
-            if (num_found < 2) return;
+                    // The attributes are reduced over the same neighbors
+                    if (attributes)
+                    {
+                        thread_local std::vector<real_t> buffer;
+                        compute_neighborhood_statistics(
+                            attributes->data(), n_channels, num_nn, [&](const size_t i) { return neighbors[i].first; },
+                            stats, buffer, &features[point_id * feature_count + geometric_count]);
+                    }
 
-            // partial sort for max_knn
-            if (num_found > max_knn)
-            {
-                std::partial_sort(
-                    result_set.begin(), result_set.begin() + max_knn, result_set.end(), nanoflann::IndexDist_Sorter());
-            }
+                    // not enough point, no feature computation
+                    if (num_nn < 2) return;
 
-            const size_t num_nn = std::min(static_cast<uint32_t>(num_found), max_knn);
+                    auto                    index_of = [&](const size_t i) { return neighbors[i].first; };
+                    const PCAResult<real_t> pca      = pca_from_indices(xyz, num_nn, index_of);
+                    compute_selected_features(pca, selected_features, &features[point_id * feature_count]);
+                    if (with_quadric)
+                    {
+                        store_quadric_features(
+                            fit_quadric_curvatures<real_t>(xyz, xyz.row(point_id), pca, num_nn, index_of),
+                            selected_features, &features[point_id * feature_count]);
+                    }
+                });
+            executor.run(taskflow).get();
+        });
 
-            PointCloud<real_t> cloud(num_nn, 3);
-            for (size_t id = 0; id < num_nn; ++id) { cloud.row(id) = xyz.row(result_set[id].first); }
-            const PCAResult<real_t> pca = pca_from_pointcloud(cloud);
-            compute_selected_features(pca, selected_features, &features[point_id * feature_count]);
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1>>(
+        features, {static_cast<size_t>(n_points), feature_count}, owner_features);
+}
+
+/**
+ * Compute a selected set of geometric features for a point cloud via radius search, each point having its own search
+ * radius.
+ *
+ * This allows density-adaptive neighborhoods (e.g. radii scaled from a coarse density estimate) without grouping the
+ * points by radius.
+ *
+ * @param xyz The point cloud
+ * @param search_radius [n_points] the search radius of each point.
+ * @param max_knn the maximum number of neighbors to fetch inside the radius. The central point is included. Fixing a
+ * reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+ * @param selected_features the list of selected features. See pgeof::EFeatureID
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend)
+ * @param weights the weight of each axis in the square distances of the search (see with_search_index). Features
+ * are computed in the original coordinates
+ * @param attributes optional [n_points, n_channels] per-point attributes, whose statistics over each neighborhood are
+ * computed from the same search (see compute_neighborhood_statistics)
+ * @param statistics the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'
+ * @return Geometric features associated with each point's neighborhood in a (num_points, features_count) nd::array,
+ * followed by the statistics of the attributes if they are given (see compute_geometric_features_selected)
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1>> compute_geometric_features_selected_adaptive(
+    RefCloud<real_t> xyz, nb::ndarray<const real_t, nb::ndim<1>> search_radius, const uint32_t max_knn,
+    const std::vector<EFeatureID>& selected_features, const std::string& backend,
+    const std::array<real_t, 3>& weights,
+    std::optional<nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>> attributes,
+    const std::vector<std::string>&                                     statistics)
+{
+    using result_item_t = nanoflann::ResultItem<Eigen::Index, real_t>;
+
+    if (search_radius.size() != static_cast<size_t>(xyz.rows()))
+    {
+        throw std::invalid_argument("search_radius should hold one radius per point");
+    }
+
+    const Eigen::Index      n_points    = xyz.rows();
+    const real_t*           radius_data = search_radius.data();
+    std::vector<EStatistic> stats;
+    const size_t            statistics_count =
+        prepare_fused_statistics(attributes, statistics, static_cast<size_t>(n_points), stats);
+    const size_t n_channels      = attributes ? attributes->shape(1) : 0;
+    const size_t geometric_count = selected_features.size();
+    const size_t feature_count   = geometric_count + statistics_count;
+    const bool   with_quadric    = has_quadric_features(selected_features);
+
+    real_t*     features = new real_t[n_points * feature_count];
+    nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
+    std::fill(features, features + n_points * feature_count, real_t(0.0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    thread_local std::vector<result_item_t> neighbors;
+
+                    const real_t radius = radius_data[point_id];
+                    BoundedHeapResultSet<real_t, Eigen::Index> result_set(neighbors, max_knn, radius * radius);
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    const size_t num_nn = result_set.size();
+
+                    // The attributes are reduced over the same neighbors
+                    if (attributes)
+                    {
+                        thread_local std::vector<real_t> buffer;
+                        compute_neighborhood_statistics(
+                            attributes->data(), n_channels, num_nn, [&](const size_t i) { return neighbors[i].first; },
+                            stats, buffer, &features[point_id * feature_count + geometric_count]);
+                    }
+
+                    // not enough point, no feature computation
+                    if (num_nn < 2) return;
+
+                    auto                    index_of = [&](const size_t i) { return neighbors[i].first; };
+                    const PCAResult<real_t> pca      = pca_from_indices(xyz, num_nn, index_of);
+                    compute_selected_features(pca, selected_features, &features[point_id * feature_count]);
+                    if (with_quadric)
+                    {
+                        store_quadric_features(
+                            fit_quadric_curvatures<real_t>(xyz, xyz.row(point_id), pca, num_nn, index_of),
+                            selected_features, &features[point_id * feature_count]);
+                    }
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
         });
-    executor.run(taskflow).get();
 
     return nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1>>(
         features, {static_cast<size_t>(n_points), feature_count}, owner_features);
 }
+
+/**
+ * Convenience function that check that radii are positive and well ordered in increasing order.
+ *
+ * @param radii the list of search radii.
+ */
+template <typename real_t>
+static bool check_radii(const std::vector<real_t>& radii)
+{
+    real_t previous_radius = real_t(0.);
+    for (const auto& current_radius : radii)
+    {
+        if (current_radius <= previous_radius) { return false; }
+        previous_radius = current_radius;
+    }
+    return true;
+}
+
+/**
+ * Compute a selected set of geometric features for a point cloud at multiple radii from a single radius search.
+ *
+ * Neighbors are searched once at the largest radius and sorted by distance. The neighborhoods of the smaller radii
+ * are prefixes of this sorted list, so their PCA is obtained by accumulating the points' moments radius after radius
+ * instead of searching and traversing each neighborhood again.
+ *
+ * @param xyz The point cloud
+ * @param radii the search radii, sorted in ascending order.
+ * @param max_knn the maximum number of neighbors to fetch inside each radius. The central point is included. Fixing
+ * a reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+ * @param selected_features the list of selected features. See pgeof::EFeatureID
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend)
+ * @param weights the weight of each axis in the square distances of the search (see with_search_index). Features
+ * are computed in the original coordinates
+ * @param attributes optional [n_points, n_channels] per-point attributes, whose statistics over the neighborhood of
+ * each radius are computed from the same search (see compute_neighborhood_statistics)
+ * @param statistics the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'
+ * @return Geometric features associated with each point's neighborhood in a (num_points, n_radii, features_count)
+ * nd::array, followed for each radius by the statistics of the attributes if they are given (see
+ * compute_geometric_features_selected)
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1, -1>> compute_geometric_features_selected_multiradius(
+    RefCloud<real_t> xyz, const std::vector<real_t>& radii, const uint32_t max_knn,
+    const std::vector<EFeatureID>& selected_features, const std::string& backend,
+    const std::array<real_t, 3>& weights,
+    std::optional<nb::ndarray<const real_t, nb::ndim<2>, nb::c_contig>> attributes,
+    const std::vector<std::string>&                                     statistics)
+{
+    using result_item_t = nanoflann::ResultItem<Eigen::Index, real_t>;
+
+    if (radii.empty() || !check_radii(radii))
+    {
+        throw std::invalid_argument("radii should be > 0 and sorted in ascending order");
+    }
+
+    const size_t            n_radii              = radii.size();
+    const Eigen::Index      n_points             = xyz.rows();
+    const real_t            sq_max_search_radius = radii.back() * radii.back();
+    std::vector<EStatistic> stats;
+    const size_t            statistics_count =
+        prepare_fused_statistics(attributes, statistics, static_cast<size_t>(n_points), stats);
+    const size_t n_channels      = attributes ? attributes->shape(1) : 0;
+    const size_t geometric_count = selected_features.size();
+    const size_t feature_count   = geometric_count + statistics_count;
+    const bool   with_quadric    = has_quadric_features(selected_features);
+
+    real_t*     features = new real_t[n_points * n_radii * feature_count];
+    nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
+    std::fill(features, features + n_points * n_radii * feature_count, real_t(0.0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            taskflow.for_each_index(
+                Eigen::Index(0), n_points, Eigen::Index(1),
+                [&](Eigen::Index point_id)
+                {
+                    thread_local std::vector<result_item_t> neighbors;
+
+                    BoundedHeapResultSet<real_t, Eigen::Index> result_set(neighbors, max_knn, sq_max_search_radius);
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    result_set.sort();
+
+                    // Grow the neighborhood radius after radius, each neighbor is accumulated once
+                    PointMoments<real_t> moments(xyz.row(point_id));
+                    size_t               i_nei = 0;
+                    for (size_t i_radius = 0; i_radius < n_radii; ++i_radius)
+                    {
+                        const real_t sq_radius = radii[i_radius] * radii[i_radius];
+                        for (; i_nei < neighbors.size() && neighbors[i_nei].second < sq_radius; ++i_nei)
+                        {
+                            moments.add(xyz.row(neighbors[i_nei].first));
+                        }
+                        real_t* radius_features = &features[(point_id * n_radii + i_radius) * feature_count];
+
+                        // The attributes are reduced over the same prefix of the sorted neighbors
+                        if (attributes)
+                        {
+                            thread_local std::vector<real_t> buffer;
+                            compute_neighborhood_statistics(
+                                attributes->data(), n_channels, i_nei,
+                                [&](const size_t i) { return neighbors[i].first; }, stats, buffer,
+                                radius_features + geometric_count);
+                        }
+
+                        // not enough point, no feature computation
+                        if (moments.count < 2) continue;
+
+                        const PCAResult<real_t> pca = pca_from_moments(moments);
+                        compute_selected_features(pca, selected_features, radius_features);
+
+                        // The quadric is fitted in the frame of each radius, on the prefix of the sorted neighbors
+                        if (with_quadric)
+                        {
+                            store_quadric_features(
+                                fit_quadric_curvatures<real_t>(
+                                    xyz, xyz.row(point_id), pca, i_nei,
+                                    [&](const size_t i) { return neighbors[i].first; }),
+                                selected_features, radius_features);
+                        }
+                    }
+                },
+                tf::StaticPartitioner(0));
+            executor.run(taskflow).get();
+        });
+
+    const size_t shape[3] = {static_cast<size_t>(n_points), n_radii, feature_count};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, -1, -1>>(features, 3, shape, owner_features);
+}
+
+/**
+ * Compute a set of geometric features for a point cloud using the optimal neighborhood selection described in
+ * http://lareg.ensg.eu/labos/matis/pdf/articles_revues/2015/isprs_wjhm_15.pdf, candidate neighborhoods being
+ * defined by radii instead of numbers of neighbors.
+ *
+ * Neighbors are searched once at the largest radius and sorted by distance. Candidate radii are then swept in
+ * ascending order, accumulating the moments of the newly included neighbors only, and the radius minimizing the
+ * eigenentropy is kept.
+ *
+ *  * The following features are computed:
+ * - linearity
+ * - planarity
+ * - scattering
+ * - verticality
+ * - normal vector (oriented towards positive z-coordinates)
+ * - length
+ * - surface
+ * - volume
+ * - curvature
+ * - optimal radius
+ *
+ * @param xyz The point cloud
+ * @param radii the candidate search radii, sorted in ascending order.
+ * @param max_knn the maximum number of neighbors to fetch inside the largest radius. The central point is included.
+ * @param k_min Minimum number of neighbors for a radius to be a candidate. If a point has less neighbors at every
+ * radius, its features will be a set of '0' values.
+ * @param verbose Whether computation progress should be printed out
+ * @param backend the KD-tree implementation, 'nanoflann' or 'implicit' (see ESearchBackend)
+ * @param weights the weight of each axis in the square distances of the search (see with_search_index). Features
+ * are computed in the original coordinates
+ * @return Geometric features associated with each point's neighborhood in a (num_points, features_count) nd::array
+ */
+template <typename real_t, const size_t feature_count = 12>
+static nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(feature_count)>>
+    compute_geometric_features_optimal_radius(
+        RefCloud<real_t> xyz, const std::vector<real_t>& radii, const uint32_t max_knn, const uint32_t k_min,
+        const bool verbose, const std::string& backend, const std::array<real_t, 3>& weights)
+{
+    using result_item_t = nanoflann::ResultItem<Eigen::Index, real_t>;
+
+    if (k_min < 1) { throw std::invalid_argument("k_min should be > 1"); }
+    if (radii.empty() || !check_radii(radii))
+    {
+        throw std::invalid_argument("radii should be > 0 and sorted in ascending order");
+    }
+
+    const size_t       n_radii              = radii.size();
+    const size_t       n_points             = static_cast<size_t>(xyz.rows());
+    size_t             s_point              = 0;
+    const real_t       sq_max_search_radius = radii.back() * radii.back();
+
+    real_t*     features = new real_t[n_points * feature_count];
+    nb::capsule owner_features(features, [](void* f) noexcept { delete[] (real_t*)f; });
+    std::fill(features, features + n_points * feature_count, real_t(0.0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    with_search_index(
+        xyz, backend, weights,
+        [&](const auto& index)
+        {
+            taskflow.for_each_index(
+                size_t(0), n_points, size_t(1),
+                [&](size_t i_point)
+                {
+                    if (verbose) log::progress(s_point, n_points);
+
+                    thread_local std::vector<result_item_t> neighbors;
+
+                    const Eigen::Index point_id = static_cast<Eigen::Index>(i_point);
+                    BoundedHeapResultSet<real_t, Eigen::Index> result_set(neighbors, max_knn, sq_max_search_radius);
+                    index.findNeighbors(result_set, xyz.row(point_id).data());
+                    // Process only if the largest neighborhood has the required number of point
+                    if (neighbors.size() < k_min) return;
+                    result_set.sort();
+
+                    PointMoments<real_t> moments(xyz.row(point_id));
+                    PCAResult<real_t>    pca_optimal;
+                    real_t               eigenentropy_optimal = real_t(1.0);
+                    real_t               radius_optimal       = real_t(0.);
+                    size_t               i_nei                = 0;
+                    for (size_t i_radius = 0; i_radius < n_radii; ++i_radius)
+                    {
+                        const real_t sq_radius = radii[i_radius] * radii[i_radius];
+                        const size_t k_prev    = moments.count;
+                        for (; i_nei < neighbors.size() && neighbors[i_nei].second < sq_radius; ++i_nei)
+                        {
+                            moments.add(xyz.row(neighbors[i_nei].first));
+                        }
+                        // A radius holding no new neighbor has the same eigenentropy as the previous one
+                        if (moments.count < k_min || (moments.count == k_prev && radius_optimal > real_t(0.))) continue;
+
+                        const PCAResult<real_t> pca          = pca_from_moments(moments);
+                        const real_t            eigenentropy = compute_eigentropy(pca);
+                        // Keep track of the optimal radius with the lowest eigenentropy
+                        if ((radius_optimal == real_t(0.)) || (eigenentropy < eigenentropy_optimal))
+                        {
+                            eigenentropy_optimal = eigenentropy;
+                            radius_optimal       = radii[i_radius];
+                            pca_optimal          = pca;
+                        }
+                    }
+                    if (radius_optimal == real_t(0.)) return;
+                    compute_features(pca_optimal, &features[i_point * feature_count]);
+                    // Add best radius
+                    features[i_point * feature_count + 11] = radius_optimal;
+                },
+                tf::StaticPartitioner(0));
+
+            executor.run(taskflow).get();
+        });
+
+    if (verbose) log::flush();
+
+    const size_t shape[2] = {n_points, feature_count};
+    return nb::ndarray<nb::numpy, real_t, nb::shape<-1, static_cast<nb::ssize_t>(feature_count)>>(
+        features, 2, shape, owner_features);
+}
 }  // namespace pgeof
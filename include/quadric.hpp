@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pca.hpp"
+
+namespace pgeof
+{
+
+// Curvatures of a surface at a point, signed with respect to the normal: positive when it bends towards the normal
+template <typename real_t>
+struct QuadricCurvatures
+{
+    real_t k1       = real_t(0.0);  // maximal principal curvature
+    real_t k2       = real_t(0.0);  // minimal principal curvature
+    real_t mean     = real_t(0.0);
+    real_t gaussian = real_t(0.0);
+};
+
+/**
+ * Check if a selection of features holds a curvature from a quadric fit, which requires the neighbors of a point and
+ * not only their PCA.
+ *
+ * @param selected_features the list of selected features.
+ * @return true if one of the features is a principal, mean or Gaussian curvature.
+ */
+static bool has_quadric_features(const std::vector<EFeatureID>& selected_features)
+{
+    return std::any_of(
+        selected_features.begin(), selected_features.end(),
+        [](const EFeatureID feature)
+        {
+            return feature == EFeatureID::PrincipalCurvature1 || feature == EFeatureID::PrincipalCurvature2 ||
+                   feature == EFeatureID::MeanCurvature || feature == EFeatureID::GaussianCurvature;
+        });
+}
+
+/**
+ * Compute the curvatures of the surface sampled by a set of points, by fitting a quadric in the PCA frame of the
+ * points.
+ *
+ * The points are expressed in the frame (v0, v1, v2) of the PCA, centered on 'origin', as (u, v, w). The height
+ * 'w = a u² + b uv + c v² + d u + e v + f' is fitted in the least squares sense, the normal equations being
+ * accumulated in fixed size matrices, so no allocation occurs. Coordinates are divided by the standard deviation along
+ * v0 to keep the system well conditioned, and a tiny ridge term keeps it solvable for degenerate (e.g. linear)
+ * neighborhoods. The curvatures are the ones of the graph of the quadric at (0, 0), from its first and second
+ * fundamental forms.
+ *
+ * @param xyz the point cloud.
+ * @param origin the point where the curvatures are computed, typically the query point.
+ * @param pca the PCA of the points.
+ * @param k_nn the number of points, at least 6 for the fit to be defined.
+ * @param index_of a callable returning the index (in xyz) of the i-th point, for i in [0, k_nn)
+ * @return the curvatures, zero if the points are too few or degenerate.
+ */
+template <typename real_t, typename IndexAccessor>
+static QuadricCurvatures<real_t> fit_quadric_curvatures(
+    RefCloud<real_t> xyz, const Vec3<real_t>& origin, const PCAResult<real_t>& pca, const size_t k_nn,
+    IndexAccessor&& index_of)
+{
+    using Vec6 = Eigen::Matrix<real_t, 6, 1>;
+    using Mat6 = Eigen::Matrix<real_t, 6, 6>;
+
+    QuadricCurvatures<real_t> curvatures;
+    const real_t              scale = std::sqrt(pca.val(0));
+    if (k_nn < 6 || !(scale > real_t(0.0))) { return curvatures; }
+    const real_t inv_scale = real_t(1.0) / scale;
+
+    Mat6 ata = Mat6::Zero();
+    Vec6 atw = Vec6::Zero();
+    for (size_t i = 0; i < k_nn; ++i)
+    {
+        const Vec3<real_t> offset = (xyz.row(static_cast<Eigen::Index>(index_of(i))) - origin) * inv_scale;
+        const real_t       u      = offset.dot(pca.v0);
+        const real_t       v      = offset.dot(pca.v1);
+        const real_t       w      = offset.dot(pca.v2);
+        const Vec6         row(u * u, u * v, v * v, u, v, real_t(1.0));
+        ata.template selfadjointView<Eigen::Lower>().rankUpdate(row);
+        atw += w * row;
+    }
+    ata.diagonal().array() += real_t(1e-6) * ata.diagonal().sum() / real_t(6.0);
+    const Eigen::LDLT<Mat6> ldlt(ata.template selfadjointView<Eigen::Lower>());
+    if (ldlt.info() != Eigen::Success) { return curvatures; }
+    const Vec6 coefficients = ldlt.solve(atw);
+
+    // Back to the original scale: second order terms are divided by the scale, first order terms are unchanged
+    const real_t a = coefficients(0) * inv_scale;
+    const real_t b = coefficients(1) * inv_scale;
+    const real_t c = coefficients(2) * inv_scale;
+    const real_t d = coefficients(3);
+    const real_t e = coefficients(4);
+
+    // First (E, F, G) and second (L, M, N) fundamental forms of the graph at (0, 0)
+    const real_t E     = real_t(1.0) + d * d;
+    const real_t F     = d * e;
+    const real_t G     = real_t(1.0) + e * e;
+    const real_t norm  = std::sqrt(real_t(1.0) + d * d + e * e);
+    const real_t L     = real_t(2.0) * a / norm;
+    const real_t M     = b / norm;
+    const real_t N     = real_t(2.0) * c / norm;
+    const real_t det_I = E * G - F * F;
+
+    curvatures.gaussian = (L * N - M * M) / det_I;
+    curvatures.mean     = (E * N - real_t(2.0) * F * M + G * L) / (real_t(2.0) * det_I);
+
+    const real_t discriminant = curvatures.mean * curvatures.mean - curvatures.gaussian;
+    const real_t half_gap     = std::sqrt(std::max(real_t(0.0), discriminant));
+    curvatures.k1             = curvatures.mean + half_gap;
+    curvatures.k2             = curvatures.mean - half_gap;
+    return curvatures;
+}
+
+/**
+ * Store the curvature features of a selection of features, the other features being left untouched.
+ *
+ * @param curvatures the curvatures.
+ * @param selected_features the list of selected features.
+ * @param feature_results the array of resulting features, in the order of selected_features.
+ */
+template <typename real_t>
+static void store_quadric_features(
+    const QuadricCurvatures<real_t>& curvatures, const std::vector<EFeatureID>& selected_features,
+    real_t* feature_results)
+{
+    for (size_t i = 0; i < selected_features.size(); ++i)
+    {
+        switch (selected_features[i])
+        {
+            case EFeatureID::PrincipalCurvature1:
+                feature_results[i] = curvatures.k1;
+                break;
+            case EFeatureID::PrincipalCurvature2:
+                feature_results[i] = curvatures.k2;
+                break;
+            case EFeatureID::MeanCurvature:
+                feature_results[i] = curvatures.mean;
+                break;
+            case EFeatureID::GaussianCurvature:
+                feature_results[i] = curvatures.gaussian;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+}  // namespace pgeof
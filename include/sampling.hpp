@@ -0,0 +1,217 @@
+#pragma once
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/algorithm/sort.hpp>
+#include <taskflow/taskflow.hpp>
+#include <utility>
+#include <vector>
+
+#include "pca.hpp"
+
+namespace nb = nanobind;
+
+namespace pgeof
+{
+
+/**
+ * Farthest point sampling over a set of candidate points: each sample is the candidate the farthest from the previous
+ * samples.
+ *
+ * The candidates are split in blocks of fixed size. At each iteration, the distance of every candidate to the samples
+ * is updated with the last sample, in parallel over the blocks, each block keeping its farthest candidate. The sample
+ * is then the farthest of the block maxima, ties being broken by the lowest candidate, so the result does not depend
+ * on the number of threads. The taskflow is built once and run at each iteration.
+ *
+ * @param xyz the point cloud.
+ * @param n_candidates the number of candidates.
+ * @param index_of a callable returning the index (in xyz) of the c-th candidate, for c in [0, n_candidates)
+ * @param n_samples the number of samples, at most n_candidates.
+ * @param start the candidate of the first sample.
+ * @param samples [n_samples] the index (in xyz) of each sample.
+ */
+template <typename real_t, typename IndexAccessor>
+static void farthest_point_sampling_candidates(
+    RefCloud<real_t> xyz, const size_t n_candidates, IndexAccessor&& index_of, const size_t n_samples,
+    const size_t start, uint32_t* samples)
+{
+    using best_t = std::pair<real_t, size_t>;
+
+    constexpr size_t block_size = 4096;
+    constexpr real_t selected   = -std::numeric_limits<real_t>::infinity();
+    const size_t     n_blocks   = (n_candidates + block_size - 1) / block_size;
+
+    // Square distance of each candidate to the samples, -inf once selected
+    std::vector<real_t> sq_dist(n_candidates, std::numeric_limits<real_t>::infinity());
+    std::vector<best_t> block_best(n_blocks);
+    size_t              last = start;
+    sq_dist[last]            = selected;
+    samples[0]               = static_cast<uint32_t>(index_of(last));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(
+        size_t(0), n_blocks, size_t(1),
+        [&](size_t b)
+        {
+            const Vec3<real_t> sample = xyz.row(index_of(last));
+            best_t             best(real_t(-1.0), 0);
+            const size_t       end = std::min(n_candidates, (b + 1) * block_size);
+            for (size_t c = b * block_size; c < end; ++c)
+            {
+                const real_t d = std::min(sq_dist[c], (xyz.row(index_of(c)) - sample).squaredNorm());
+                sq_dist[c]     = d;
+                if (d > best.first) { best = best_t(d, c); }
+            }
+            block_best[b] = best;
+        },
+        tf::StaticPartitioner(0));
+
+    for (size_t s = 1; s < n_samples; ++s)
+    {
+        executor.run(taskflow).get();
+        best_t best = block_best[0];
+        for (size_t b = 1; b < n_blocks; ++b)
+        {
+            if (block_best[b].first > best.first) { best = block_best[b]; }
+        }
+        last          = best.second;
+        sq_dist[last] = selected;
+        samples[s]    = static_cast<uint32_t>(index_of(last));
+    }
+}
+
+/**
+ * Select one point per occupied voxel of a regular grid, the closest to the center of its voxel.
+ *
+ * The voxel of each point is computed in parallel, the points are sorted by voxel and by distance to the center of
+ * their voxel (in parallel), and the first point of each voxel is kept.
+ *
+ * @param xyz the point cloud.
+ * @param voxel_size the size of the voxels.
+ * @param voxel_of [n_points] the rank of the voxel of each point among the kept points.
+ * @return the index of the kept point of each voxel, by increasing voxel key.
+ */
+template <typename real_t>
+static std::vector<uint32_t> voxel_representatives(
+    RefCloud<real_t> xyz, const real_t voxel_size, std::vector<uint32_t>& voxel_of)
+{
+    constexpr uint64_t max_cells = uint64_t(1) << 21;
+    const size_t       n_points  = static_cast<size_t>(xyz.rows());
+    const Vec3<real_t> origin    = xyz.colwise().minCoeff();
+    const Vec3<real_t> extent    = xyz.colwise().maxCoeff() - origin;
+    if (((extent / voxel_size).array() >= real_t(max_cells - 1)).any())
+    {
+        throw std::invalid_argument("voxel_size is too small: the grid should have less than 2^21 cells per axis");
+    }
+
+    // Voxel key (21 bits per axis) and square distance to the voxel center of each point
+    std::vector<uint64_t> keys(n_points);
+    std::vector<real_t>   center_dist(n_points);
+    std::vector<uint32_t> order(n_points);
+    std::iota(order.begin(), order.end(), uint32_t(0));
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    tf::Task     keying = taskflow.for_each_index(
+        size_t(0), n_points, size_t(1),
+        [&](size_t i)
+        {
+            const Vec3<real_t> position = (xyz.row(i) - origin) / voxel_size;
+            uint64_t           key      = 0;
+            real_t             sq_dist  = real_t(0.0);
+            for (size_t d = 0; d < 3; ++d)
+            {
+                const real_t cell = std::floor(position(d));
+                key               = (key << 21) | static_cast<uint64_t>(cell);
+                sq_dist += (position(d) - cell - real_t(0.5)) * (position(d) - cell - real_t(0.5));
+            }
+            keys[i]        = key;
+            center_dist[i] = sq_dist;
+        },
+        tf::StaticPartitioner(0));
+    tf::Task sorting = taskflow.sort(
+        order.begin(), order.end(),
+        [&](const uint32_t a, const uint32_t b)
+        {
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            if (center_dist[a] != center_dist[b]) return center_dist[a] < center_dist[b];
+            return a < b;
+        });
+    keying.precede(sorting);
+    executor.run(taskflow).get();
+
+    std::vector<uint32_t> representatives;
+    voxel_of.resize(n_points);
+    for (size_t r = 0; r < n_points; ++r)
+    {
+        const uint32_t i = order[r];
+        if (r == 0 || keys[i] != keys[order[r - 1]]) { representatives.push_back(i); }
+        voxel_of[i] = static_cast<uint32_t>(representatives.size() - 1);
+    }
+    return representatives;
+}
+
+/**
+ * Farthest point sampling (FPS) of a point cloud, see farthest_point_sampling_candidates.
+ *
+ * The exact sampling considers every point. The approximate sampling (voxel_size > 0) only considers one point per
+ * occupied voxel, the closest to the center of its voxel, so each iteration costs the number of occupied voxels rather
+ * than the number of points. Its samples are farthest up to the voxel size.
+ *
+ * @param xyz the point cloud.
+ * @param n_samples the number of samples.
+ * @param start_index the index of the first sample (with the approximate sampling, the first sample is the point kept
+ * in the voxel of this point).
+ * @param voxel_size the size of the voxels of the approximate sampling, 0 for the exact sampling.
+ * @return the indices of the samples, in their order of selection, in a (n_samples,) nd::array.
+ */
+template <typename real_t>
+static nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>> farthest_point_sampling(
+    RefCloud<real_t> xyz, const size_t n_samples, const size_t start_index, const real_t voxel_size)
+{
+    const size_t n_points = static_cast<size_t>(xyz.rows());
+    if (n_points >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many points to be indexed with uint32 indices");
+    }
+    if (n_samples == 0 || n_samples > n_points)
+    {
+        throw std::invalid_argument("n_samples should be in [1, n_points]");
+    }
+    if (start_index >= n_points) { throw std::invalid_argument("start_index should be lower than n_points"); }
+    if (voxel_size < real_t(0.0)) { throw std::invalid_argument("voxel_size should be >= 0"); }
+
+    uint32_t*   samples = new uint32_t[n_samples];
+    nb::capsule owner_samples(samples, [](void* p) noexcept { delete[] (uint32_t*)p; });
+
+    if (voxel_size > real_t(0.0))
+    {
+        std::vector<uint32_t>       voxel_of;
+        const std::vector<uint32_t> candidates = voxel_representatives(xyz, voxel_size, voxel_of);
+        if (candidates.size() < n_samples)
+        {
+            throw std::invalid_argument("voxel_size is too large: there are less occupied voxels than n_samples");
+        }
+        farthest_point_sampling_candidates(
+            xyz, candidates.size(), [&](const size_t c) { return candidates[c]; }, n_samples, voxel_of[start_index],
+            samples);
+    }
+    else
+    {
+        farthest_point_sampling_candidates(
+            xyz, n_points, [](const size_t c) { return c; }, n_samples, start_index, samples);
+    }
+
+    return nb::ndarray<nb::numpy, uint32_t, nb::ndim<1>>(samples, {n_samples}, owner_samples);
+}
+
+}  // namespace pgeof
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <nanoflann.hpp>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "implicit_kdtree.hpp"
+#include "pca.hpp"
+
+namespace pgeof
+{
+
+// KD-tree implementation used by the neighbor searches
+typedef enum ESearchBackend
+{
+    Nanoflann = 0,  // nanoflann KD-tree, nodes are allocated in a pool and linked by pointers
+    Implicit  // pointer-free balanced KD-tree stored in flat arrays, see ImplicitKDTree
+} ESearchBackend;
+
+/**
+ * Convert the name of a search backend into a ESearchBackend.
+ *
+ * @param backend one of 'nanoflann' or 'implicit'
+ * @return the corresponding ESearchBackend
+ */
+static ESearchBackend search_backend_from_string(const std::string& backend)
+{
+    if (backend == "nanoflann") { return ESearchBackend::Nanoflann; }
+    if (backend == "implicit") { return ESearchBackend::Implicit; }
+    throw std::invalid_argument("backend should be one of 'nanoflann' or 'implicit'");
+}
+
+// The nanoflann index of a point cloud, searched with the euclidean distance
+template <typename real_t>
+using nanoflann_index_t =
+    typename nanoflann::KDTreeEigenMatrixAdaptor<RefCloud<real_t>, 3, nanoflann::metric_L2_Simple>::index_t;
+
+/**
+ * A nanoflann dataset adaptor scaling the point cloud coordinates on the fly, so that a nanoflann index searches the
+ * scaled point cloud without copying it.
+ */
+template <typename real_t>
+struct ScaledCloudAdaptor
+{
+    RefCloud<real_t>      data;
+    std::array<real_t, 3> scale;
+
+    size_t kdtree_get_point_count() const { return static_cast<size_t>(data.rows()); }
+    real_t kdtree_get_pt(const Eigen::Index idx, const size_t dim) const { return data(idx, dim) * scale[dim]; }
+    template <class BBOX>
+    bool kdtree_get_bbox(BBOX&) const
+    {
+        return false;
+    }
+};
+
+/**
+ * A nanoflann index over a scaled point cloud (see ScaledCloudAdaptor), query points being scaled the same way before
+ * the search. It exposes the findNeighbors interface of a nanoflann index.
+ */
+template <typename real_t>
+class ScaledNanoflannIndex
+{
+   public:
+    using metric_t = nanoflann::L2_Simple_Adaptor<real_t, ScaledCloudAdaptor<real_t>, real_t, Eigen::Index>;
+    using index_t  = nanoflann::KDTreeSingleIndexAdaptor<metric_t, ScaledCloudAdaptor<real_t>, 3, Eigen::Index>;
+
+    ScaledNanoflannIndex(RefCloud<real_t> data, const std::array<real_t, 3>& scale)
+        : adaptor_{data, scale},
+          index_(
+              3, adaptor_,
+              nanoflann::KDTreeSingleIndexAdaptorParams(10, nanoflann::KDTreeSingleIndexAdaptorFlags::None, 0))
+    {
+    }
+
+    template <typename ResultSet>
+    bool findNeighbors(ResultSet& result_set, const real_t* query_point) const
+    {
+        const std::array<real_t, 3>& scale     = adaptor_.scale;
+        const real_t                 scaled[3] = {query_point[0] * scale[0], query_point[1] * scale[1],
+                                                  query_point[2] * scale[2]};
+        return index_.findNeighbors(result_set, scaled);
+    }
+
+   private:
+    // The index refers to the adaptor, which should thus be constructed first
+    const ScaledCloudAdaptor<real_t> adaptor_;
+    const index_t                    index_;
+};
+
+/**
+ * Check the per-axis weights of an anisotropic search.
+ *
+ * @param weights the weight of each axis in the square distance
+ * @return true if the weights define the euclidean distance (all weights being 1)
+ */
+template <typename real_t>
+static bool check_axis_weights(const std::array<real_t, 3>& weights)
+{
+    for (const real_t weight : weights)
+    {
+        if (!(weight > real_t(0.0)) || !std::isfinite(weight))
+        {
+            throw std::invalid_argument("axis weights should be finite and > 0");
+        }
+    }
+    return weights[0] == real_t(1.0) && weights[1] == real_t(1.0) && weights[2] == real_t(1.0);
+}
+
+/**
+ * Build the KD-tree of a point cloud with the requested backend and metric, and run a function on it.
+ *
+ * The function is called with a 'const index_t&' exposing findNeighbors(result_set, query_point), it should be a
+ * generic lambda so that it is instantiated for each backend. Query points are given in the original coordinates, the
+ * square distances being 'w_x * dx^2 + w_y * dy^2 + w_z * dz^2' with the per-axis 'weights'. Anisotropic searches run
+ * on a point cloud scaled by the square root of the weights: on the fly for nanoflann, in the copy held by the
+ * implicit KD-tree.
+ *
+ * @param data the point cloud
+ * @param backend the name of the search backend, see ESearchBackend
+ * @param weights the weight of each axis in the square distance
+ * @param function the function to run on the index
+ * @return the value returned by the function
+ */
+template <typename real_t, typename Function>
+static auto with_search_index(
+    RefCloud<real_t> data, const std::string& backend, const std::array<real_t, 3>& weights, Function&& function)
+{
+    using kd_tree_t = nanoflann::KDTreeEigenMatrixAdaptor<RefCloud<real_t>, 3, nanoflann::metric_L2_Simple>;
+
+    const bool                  euclidean = check_axis_weights(weights);
+    const std::array<real_t, 3> scale     = {std::sqrt(weights[0]), std::sqrt(weights[1]), std::sqrt(weights[2])};
+    if (search_backend_from_string(backend) == ESearchBackend::Implicit)
+    {
+        const ImplicitKDTree<real_t> kd_tree(data, 10, scale);
+        return function(kd_tree);
+    }
+    if (!euclidean)
+    {
+        const ScaledNanoflannIndex<real_t> kd_tree(data, scale);
+        return function(kd_tree);
+    }
+    const kd_tree_t kd_tree(3, data, 10, 0);
+    return function(*kd_tree.index_);
+}
+
+}  // namespace pgeof
@@ -1,9 +1,25 @@
 from .pgeof_ext import (
     EFeatureID,
+    EOptimalCriterion,
     compute_features,
     compute_features_multiscale,
     compute_features_optimal,
+    compute_features_optimal_radius,
     knn_search,
     radius_search,
-    compute_features_selected
+    knn_graph,
+    cloud_distance,
+    chamfer_distance,
+    m3c2,
+    orient_normals,
+    compute_fpfh,
+    compute_normal_features,
+    neighborhood_statistics,
+    statistical_outlier_filter,
+    radius_outlier_filter,
+    farthest_point_sampling,
+    dbscan,
+    region_growing,
+    compute_features_selected,
+    compute_features_selected_adaptive
 )
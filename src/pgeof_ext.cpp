@@ -1,9 +1,27 @@
 
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <nanobind/stl/array.h>
+#include <nanobind/stl/map.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/pair.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
 #include <nanobind/stl/vector.h>
 
+#include <limits>
+
+#include "cloud_distance.hpp"
+#include "clustering.hpp"
+#include "fpfh.hpp"
+#include "knn_graph.hpp"
+#include "m3c2.hpp"
+#include "neighborhood_statistics.hpp"
+#include "normal_features.hpp"
+#include "normal_orientation.hpp"
 #include "nn_search.hpp"
+#include "outlier_filter.hpp"
+#include "sampling.hpp"
 #include "pgeof.hpp"
 
 namespace nb = nanobind;
@@ -30,7 +48,15 @@ NB_MODULE(pgeof_ext, m)
         .value("K_optimal", pgeof::EFeatureID::K_optimal)  // TODO: remove or handle
         .value("Verticality", pgeof::EFeatureID::Verticality)
         .value("Eigentropy", pgeof::EFeatureID::Eigentropy)
+        .value("PrincipalCurvature1", pgeof::EFeatureID::PrincipalCurvature1)
+        .value("PrincipalCurvature2", pgeof::EFeatureID::PrincipalCurvature2)
+        .value("MeanCurvature", pgeof::EFeatureID::MeanCurvature)
+        .value("GaussianCurvature", pgeof::EFeatureID::GaussianCurvature)
         .export_values();
+    nb::enum_<pgeof::EOptimalCriterion>(m, "EOptimalCriterion")
+        .value("Eigentropy", pgeof::EOptimalCriterion::EigentropyCriterion)
+        .value("Dimensionality", pgeof::EOptimalCriterion::DimensionalityCriterion)
+        .value("CurvatureStability", pgeof::EOptimalCriterion::CurvatureStabilityCriterion);
     m.def(
         "compute_features", &pgeof::compute_geometric_features<float>, "xyz"_a.noconvert(), "nn"_a.noconvert(),
         "nn_ptr"_a.noconvert(), "k_min"_a = 1, "verbose"_a = false, R"(
@@ -86,7 +112,7 @@ NB_MODULE(pgeof_ext, m)
     m.def(
         "compute_features_optimal", &pgeof::compute_geometric_features_optimal<float>, "xyz"_a.noconvert(),
         "nn"_a.noconvert(), "nn_ptr"_a.noconvert(), "k_min"_a = 1, "k_step"_a = 1, "k_min_search"_a = 1,
-        "verbose"_a = false, R"(
+        "verbose"_a = false, "search"_a = "exhaustive", R"(
             Compute a set of geometric features for a point cloud using the optimal neighborhood selection described in
             http://lareg.ensg.eu/labos/matis/pdf/articles_revues/2015/isprs_wjhm_15.pdf
 
@@ -113,23 +139,229 @@ NB_MODULE(pgeof_ext, m)
             :param k_min_search: Minimum neighborhood size at which to start when searching for the optimal neighborhood size for
             each point. It is advised to use a value of 10 or higher, for geometric features robustness.
             :param verbose: Whether computation progress should be printed out
+            :param search: the candidates sweep strategy. 'exhaustive' evaluates every candidate, 'coarse_to_fine' evaluates
+            about sqrt(n_candidates) evenly spaced candidates then every candidate between the neighbors of the best one,
+            'log' evaluates log-spaced candidates only. The two last strategies trade exactness for fewer eigen decompositions.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+        )");
+    m.def(
+        "compute_features_optimal", &pgeof::compute_geometric_features_optimal_criteria<float>, "xyz"_a.noconvert(),
+        "nn"_a.noconvert(), "nn_ptr"_a.noconvert(), "criteria"_a, "k_min"_a = 1, "k_step"_a = 1, "k_min_search"_a = 1,
+        "verbose"_a = false, "search"_a = "exhaustive", R"(
+            Compute a set of geometric features for a point cloud using the optimal neighborhood selection, evaluating
+            several selection criteria in the same sweep over the candidate neighborhood sizes.
+
+            The neighborhoods' PCA is shared by all the criteria. The features are computed at the optimal neighborhood
+            of the first criterion.
+
+            :param xyz: the point cloud
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive,
+            '-1' indices will either crash or silently compute incorrect features.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'. More specifically, the neighbors of point 'i'
+            are 'nn[nn_ptr[i]:nn_ptr[i + 1]]'.
+            :param criteria: List of criteria to evaluate. See EOptimalCriterion
+            :param k_min: Minimum number of neighbors to consider for features computation. If a point has less,
+            its features and optimal sizes will be a set of '0' values.
+            :param k_step: Step size to take when searching for the optimal neighborhood
+            :param k_min_search: Minimum neighborhood size at which to start when searching for the optimal neighborhood size
+            :param verbose: Whether computation progress should be printed out
+            :param search: the candidates sweep strategy, 'exhaustive' or 'log'.
+            :return: a pair of arrays, the geometric features (computed with the first criterion) in a
+            (num_points, features_count) numpy array and the optimal neighborhood size of each criterion in a
+            (num_points, n_criteria) numpy array.
+        )");
+    m.def(
+        "compute_features_optimal_radius", &pgeof::compute_geometric_features_optimal_radius<double>,
+        "xyz"_a.noconvert(), "radii"_a, "max_knn"_a, "k_min"_a = 1, "verbose"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, R"(
+            Compute a set of geometric features for a point cloud using the optimal neighborhood selection described in
+            http://lareg.ensg.eu/labos/matis/pdf/articles_revues/2015/isprs_wjhm_15.pdf, candidate neighborhoods being
+            defined by radii instead of numbers of neighbors (double precision version).
+
+            Neighbors are searched once at the largest radius and the candidate radii are swept incrementally over the
+            distance-sorted neighbors.
+
+            * The following features are computed:
+            - linearity
+            - planarity
+            - scattering
+            - verticality
+            - normal vector (oriented towards positive z-coordinates)
+            - length
+            - surface
+            - volume
+            - curvature
+            - optimal radius
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param radii: the candidate search radii, sorted in ascending order.
+            :param max_knn: the maximum number of neighbors to fetch inside the largest sphere. The central point is included.
+            :param k_min: Minimum number of neighbors for a radius to be a candidate. If a point has less neighbors at every
+            radius, its features will be a set of '0' values.
+            :param verbose: Whether computation progress should be printed out
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+        )");
+    m.def(
+        "compute_features_optimal_radius", &pgeof::compute_geometric_features_optimal_radius<float>,
+        "xyz"_a.noconvert(), "radii"_a, "max_knn"_a, "k_min"_a = 1, "verbose"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, R"(
+            Compute a set of geometric features for a point cloud using the optimal neighborhood selection described in
+            http://lareg.ensg.eu/labos/matis/pdf/articles_revues/2015/isprs_wjhm_15.pdf, candidate neighborhoods being
+            defined by radii instead of numbers of neighbors (float precision version).
+
+            Neighbors are searched once at the largest radius and the candidate radii are swept incrementally over the
+            distance-sorted neighbors.
+
+            * The following features are computed:
+            - linearity
+            - planarity
+            - scattering
+            - verticality
+            - normal vector (oriented towards positive z-coordinates)
+            - length
+            - surface
+            - volume
+            - curvature
+            - optimal radius
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param radii: the candidate search radii, sorted in ascending order.
+            :param max_knn: the maximum number of neighbors to fetch inside the largest sphere. The central point is included.
+            :param k_min: Minimum number of neighbors for a radius to be a candidate. If a point has less neighbors at every
+            radius, its features will be a set of '0' values.
+            :param verbose: Whether computation progress should be printed out
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
             :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
         )");
-    m.def("knn_search", &pgeof::nanoflann_knn_search<float>, "data"_a.noconvert(), "query"_a.noconvert(), "knn"_a, R"(
-        Given two point clouds, compute for each point present in one of the point cloud 
-        the N closest points in the other point cloud
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search<float>, "data"_a.noconvert(), "query"_a.noconvert(), "knn"_a,
+        "return_distances"_a = true, "exclude_self"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, R"(
+            Given two point clouds, compute for each point present in one of the point cloud 
+            the N closest points in the other point cloud
+
+            It should be faster than scipy.spatial.KDTree for this task.
+            
+            :param data: the reference point cloud. A numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries. A numpy array of shape (n, 3).
+            :param knn: the number of neighbors to take into account for each point.
+            :param return_distances: Whether the square distances should be computed and returned. If False, None is
+            returned in their place and no distance array is allocated.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :return: a pair of arrays, both of size (n_points x knn), the first one contains the indices of each neighbor, the
+            second one the square distances between the query point and each of its neighbors.
+        )");
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search_double, "data"_a.noconvert(), "query"_a.noconvert(), "knn"_a,
+        "return_distances"_a = true, "exclude_self"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "float32_distances"_a = false, R"(
+            Given two double precision point clouds, compute for each point present in one of the point cloud
+            the N closest points in the other point cloud. Large coordinates (e.g. UTM) are searched without
+            downcasting nor copying the point clouds.
 
-        It should be faster than scipy.spatial.KDTree for this task.
-        
-        :param data: the reference point cloud. A numpy array of shape (n, 3).
-        :param query: the point cloud used for the queries. A numpy array of shape (n, 3).
-        :param knn: the number of neighbors to take into account for each point.
-        :return: a pair of arrays, both of size (n_points x knn), the first one contains the indices of each neighbor, the
-        second one the square distances between the query point and each of its neighbors.
-    )");
+            :param data: the reference point cloud. A float64 numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries. A float64 numpy array of shape (n, 3).
+            :param knn: the number of neighbors to take into account for each point.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :param float32_distances: Whether the square distances, computed in double precision, should be returned as a
+            float32 array instead of a float64 array.
+            :return: a pair of arrays, both of size (n_points x knn), the first one contains the indices of each neighbor, the
+            second one the square distances between the query point and each of its neighbors.
+        )");
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search_csr<float>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "knn"_a.noconvert(), "return_distances"_a = true, "exclude_self"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, R"(
+            Given two point clouds, compute for each point present in one of the point cloud its own number of
+            closest points in the other point cloud, neighbors being returned in CSR format.
+
+            :param data: the reference point cloud. A numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries. A numpy array of shape (n, 3).
+            :param knn: the number of neighbors to take into account for each query. A uint32 numpy array of shape (n,).
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :return: a tuple of arrays, 'nn' the flattened indices of the neighbors sorted by increasing distance for each query,
+            'nn_ptr' [n_queries+1] pointers wrt 'nn' (the neighbors of query 'i' are 'nn[nn_ptr[i]:nn_ptr[i + 1]]'), and the
+            'square_distances' aligned with 'nn'. 'nn' and 'nn_ptr' can directly be used by the feature computation functions.
+        )");
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search_csr_double, "data"_a.noconvert(), "query"_a.noconvert(),
+        "knn"_a.noconvert(), "return_distances"_a = true, "exclude_self"_a = false, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "float32_distances"_a = false, R"(
+            Given two double precision point clouds, compute for each point present in one of the point cloud its own
+            number of closest points in the other point cloud, neighbors being returned in CSR format.
+
+            :param data: the reference point cloud. A float64 numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries. A float64 numpy array of shape (n, 3).
+            :param knn: the number of neighbors to take into account for each query. A uint32 numpy array of shape (n,).
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :param float32_distances: Whether the square distances, computed in double precision, should be returned as a
+            float32 array instead of a float64 array.
+            :return: a tuple of arrays, 'nn', 'nn_ptr' [n_queries+1] and the 'square_distances' aligned with 'nn'.
+        )");
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search_nd<float>, "data"_a.noconvert(), "query"_a.noconvert(), "knn"_a,
+        "return_distances"_a = true, "exclude_self"_a = false, R"(
+            Given two sets of points of any dimension (e.g. feature vectors), compute for each query point the N
+            closest points in the reference set (float precision version). The search is specialized at compile time for
+            the dimensions 2, 3, 4, 6, 8, 11, 14 and 16.
+
+            :param data: the reference points. A float32 numpy array of shape (n, d).
+            :param query: the query points. A float32 numpy array of shape (m, d).
+            :param knn: the number of neighbors to take into account for each point.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query points must
+            be the data points.
+            :return: a pair of arrays, both of size (m x knn), the first one contains the indices of each neighbor, the
+            second one the square distances between the query point and each of its neighbors.
+        )");
+    m.def(
+        "knn_search", &pgeof::nanoflann_knn_search_nd<double>, "data"_a.noconvert(), "query"_a.noconvert(), "knn"_a,
+        "return_distances"_a = true, "exclude_self"_a = false, R"(
+            Given two sets of points of any dimension (e.g. feature vectors), compute for each query point the N
+            closest points in the reference set (double precision version). The search is specialized at compile time for
+            the dimensions 2, 3, 4, 6, 8, 11, 14 and 16.
+
+            :param data: the reference points. A float64 numpy array of shape (n, d).
+            :param query: the query points. A float64 numpy array of shape (m, d).
+            :param knn: the number of neighbors to take into account for each point.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query points must
+            be the data points.
+            :return: a pair of arrays, both of size (m x knn), the first one contains the indices of each neighbor, the
+            second one the square distances between the query point and each of its neighbors.
+        )");
     m.def(
         "radius_search", &pgeof::nanoflann_radius_search<float>, "data"_a.noconvert(), "query"_a.noconvert(),
-        "search_radius"_a, "max_knn"_a, R"(
+        "search_radius"_a, "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false,
+        "backend"_a = "nanoflann", "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, R"(
             Search for the points within a specified sphere in a point cloud.
             
             It could be a fallback replacement for FRNN into SuperPointTransformer code base.
@@ -140,14 +372,726 @@ NB_MODULE(pgeof_ext, m)
             :param search_radius: the search radius.
             :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included. Fixing a
             reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place
+            and no distance array is allocated.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
             :return: a pair of arrays, both of size (n_points x knn), the first one contains the 'indices' of each neighbor,
             the second one the 'square_distances' between the query point and each neighbor. Point having a number of neighbors <
             'max_knn' inside the 'search_radius' will have their 'indices' and and 'square_distances' filled respectively with
             '-1' and 'O' for any missing neighbor.
         )");
+    m.def(
+        "radius_search", &pgeof::nanoflann_radius_search_double, "data"_a.noconvert(), "query"_a.noconvert(),
+        "search_radius"_a, "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false,
+        "backend"_a = "nanoflann", "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "float32_distances"_a = false,
+        R"(
+            Search for the points within a specified sphere in a double precision point cloud. Large coordinates (e.g.
+            UTM) are searched without downcasting nor copying the point clouds.
+
+            :param data: the reference point cloud. A float64 numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries (sphere centers). A float64 numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :param float32_distances: Whether the square distances, computed in double precision, should be returned as a
+            float32 array instead of a float64 array.
+            :return: a pair of arrays, both of size (n_points x knn), the 'indices' of each neighbor ('-1' for missing
+            neighbors) and the 'square_distances' between the query point and each neighbor ('0' for missing neighbors).
+        )");
+    m.def(
+        "radius_search", &pgeof::nanoflann_radius_search_csr<float>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "search_radius"_a.noconvert(), "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false,
+        "backend"_a = "nanoflann", "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, R"(
+            Search for the points within a per-query sphere in a point cloud, neighbors being returned in CSR format.
+
+            Each query has its own search radius (e.g. scaled from a coarse density estimate).
+
+            :param data: the reference point cloud. A numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries (sphere centers). A numpy array of shape (n, 3).
+            :param search_radius: the search radius of each query. A numpy array of shape (n,).
+            :param max_knn: the maximum number of neighbors to fetch inside each sphere.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :return: a tuple of arrays, 'nn' the flattened indices of the neighbors sorted by increasing distance for each query,
+            'nn_ptr' [n_queries+1] pointers wrt 'nn' (the neighbors of query 'i' are 'nn[nn_ptr[i]:nn_ptr[i + 1]]'), and the
+            'square_distances' aligned with 'nn'. 'nn' and 'nn_ptr' can directly be used by the feature computation functions.
+        )");
+    m.def(
+        "radius_search", &pgeof::nanoflann_radius_search_csr_double, "data"_a.noconvert(), "query"_a.noconvert(),
+        "search_radius"_a.noconvert(), "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false,
+        "backend"_a = "nanoflann", "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "float32_distances"_a = false,
+        R"(
+            Search for the points within a per-query sphere in a double precision point cloud, neighbors being returned
+            in CSR format.
+
+            :param data: the reference point cloud. A float64 numpy array of shape (n, 3).
+            :param query: the point cloud used for the queries (sphere centers). A float64 numpy array of shape (n, 3).
+            :param search_radius: the search radius of each query. A float64 numpy array of shape (n,).
+            :param max_knn: the maximum number of neighbors to fetch inside each sphere.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query point cloud
+            must be the data point cloud.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances, e.g. (1, 1, 4) to search with z
+            distances counting twice. Returned square distances and radii are in this weighted metric.
+            :param float32_distances: Whether the square distances, computed in double precision, should be returned as a
+            float32 array instead of a float64 array.
+            :return: a tuple of arrays, 'nn', 'nn_ptr' [n_queries+1] and the 'square_distances' aligned with 'nn'.
+        )");
+    m.def(
+        "radius_search", &pgeof::nanoflann_radius_search_nd<float>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "search_radius"_a, "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false, R"(
+            Search for the points within a specified sphere in a set of points of any dimension (e.g. feature
+            vectors, float precision version).
+
+            :param data: the reference points. A float32 numpy array of shape (n, d).
+            :param query: the query points (sphere centers). A float32 numpy array of shape (m, d).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query points must
+            be the data points.
+            :return: a pair of arrays, both of size (m x max_knn), the indices of each neighbor and the square distances
+            between the query point and each of its neighbors. Missing neighbors have an index of '-1' and a distance of '0'.
+        )");
+    m.def(
+        "radius_search", &pgeof::nanoflann_radius_search_nd<double>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "search_radius"_a, "max_knn"_a, "return_distances"_a = true, "exclude_self"_a = false, R"(
+            Search for the points within a specified sphere in a set of points of any dimension (e.g. feature
+            vectors, double precision version).
+
+            :param data: the reference points. A float64 numpy array of shape (n, d).
+            :param query: the query points (sphere centers). A float64 numpy array of shape (m, d).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius.
+            :param return_distances: Whether the square distances should be returned. If False, None is returned in their place.
+            :param exclude_self: Whether each query point should be excluded from its own neighbors. The query points must
+            be the data points.
+            :return: a pair of arrays, both of size (m x max_knn), the indices of each neighbor and the square distances
+            between the query point and each of its neighbors. Missing neighbors have an index of '-1' and a distance of '0'.
+        )");
+    m.def(
+        "knn_graph", &pgeof::knn_graph<float, uint32_t>, "nn"_a.noconvert(), "sq_dist"_a = nb::none(),
+        "mode"_a = "symmetric", "max_distance"_a = std::numeric_limits<float>::infinity(), R"(
+            Build a directed, symmetric or mutual graph from the neighbors of a point cloud searched against itself, as
+            returned by knn_search or radius_search, optionally pruning the edges longer than a given distance.
+
+            :param nn: the neighbor indices. A numpy array of shape (n, k). '-1' indices are ignored.
+            :param sq_dist: the square distances between each point and its neighbors. A numpy array of shape (n, k). It is
+            required for pruning, and the edge square distances are returned only if it is given.
+            :param mode: 'directed' keeps the neighbors as is, 'symmetric' adds the reversed edges (j in N(i) or i in N(j)),
+            'mutual' keeps the edges present in both directions (j in N(i) and i in N(j)).
+            :param max_distance: the edges longer than this distance are removed.
+            :return: a tuple of arrays, 'nn', 'nn_ptr' [n_points+1] and the 'square_distances' of the edges aligned with 'nn'
+            (None if sq_dist is not given). Neighbors are sorted by increasing distance if sq_dist is given, by increasing
+            index otherwise. 'nn' and 'nn_ptr' can directly be used by the feature computation functions.
+        )");
+    m.def(
+        "knn_graph", &pgeof::knn_graph<float, int32_t>, "nn"_a.noconvert(), "sq_dist"_a = nb::none(),
+        "mode"_a = "symmetric", "max_distance"_a = std::numeric_limits<float>::infinity(), R"(
+            Build a directed, symmetric or mutual graph from the neighbors of a point cloud searched against itself, as
+            returned by knn_search or radius_search, optionally pruning the edges longer than a given distance.
+
+            :param nn: the neighbor indices. A numpy array of shape (n, k). '-1' indices are ignored.
+            :param sq_dist: the square distances between each point and its neighbors. A numpy array of shape (n, k). It is
+            required for pruning, and the edge square distances are returned only if it is given.
+            :param mode: 'directed' keeps the neighbors as is, 'symmetric' adds the reversed edges (j in N(i) or i in N(j)),
+            'mutual' keeps the edges present in both directions (j in N(i) and i in N(j)).
+            :param max_distance: the edges longer than this distance are removed.
+            :return: a tuple of arrays, 'nn', 'nn_ptr' [n_points+1] and the 'square_distances' of the edges aligned with 'nn'
+            (None if sq_dist is not given). Neighbors are sorted by increasing distance if sq_dist is given, by increasing
+            index otherwise. 'nn' and 'nn_ptr' can directly be used by the feature computation functions.
+        )");
+    m.def(
+        "knn_graph", &pgeof::knn_graph_csr<float>, "nn"_a.noconvert(), "nn_ptr"_a.noconvert(),
+        "sq_dist"_a = nb::none(), "mode"_a = "symmetric", "max_distance"_a = std::numeric_limits<float>::infinity(),
+        R"(
+            Build a directed, symmetric or mutual graph from neighbors given in CSR format (e.g. the output of a CSR
+            knn_search or radius_search of a point cloud against itself), optionally pruning the edges by distance.
+
+            :param nn: Integer 1D array. Flattened neighbor indices.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param sq_dist: the square distances aligned with 'nn'. It is required for pruning, and the edge square
+            distances are returned only if it is given.
+            :param mode: 'directed', 'symmetric' or 'mutual'.
+            :param max_distance: the edges longer than this distance are removed.
+            :return: a tuple of arrays, 'nn', 'nn_ptr' [n_points+1] and the 'square_distances' of the edges aligned with 'nn'
+            (None if sq_dist is not given), in the same format as the input.
+        )");
+    m.def(
+        "cloud_distance", &pgeof::cloud_to_cloud_distance<float>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "percentiles"_a = std::vector<float>{}, "return_distances"_a = false, "backend"_a = "nanoflann", R"(
+            Compute the cloud-to-cloud (C2C) distance from a compared point cloud to a reference point cloud, i.e. the
+            distance from each query point to its nearest data point, and its reductions, in one parallel pass. No neighbor
+            index is stored (float precision version).
+
+            :param data: the reference point cloud. A numpy array of shape (n, 3).
+            :param query: the compared point cloud. A numpy array of shape (m, 3).
+            :param percentiles: the percentiles of the distances to compute, in [0, 100], e.g. [50, 95, 99]. They are
+            interpolated linearly, as numpy.percentile does.
+            :param return_distances: Whether the distance of each query point should be returned. If False, None is returned
+            in their place.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple with a dict of reductions of the distances ('mean', 'rms', 'min' and 'max', 'max' being the
+            one-sided Hausdorff distance), an array of the requested percentiles and the array (m,) of the distance of each
+            query point (or None).
+        )");
+    m.def(
+        "cloud_distance", &pgeof::cloud_to_cloud_distance<double>, "data"_a.noconvert(), "query"_a.noconvert(),
+        "percentiles"_a = std::vector<double>{}, "return_distances"_a = false, "backend"_a = "nanoflann", R"(
+            Compute the cloud-to-cloud (C2C) distance from a compared point cloud to a reference point cloud, i.e. the
+            distance from each query point to its nearest data point, and its reductions, in one parallel pass. No neighbor
+            index is stored (double precision version).
+
+            :param data: the reference point cloud. A numpy array of shape (n, 3).
+            :param query: the compared point cloud. A numpy array of shape (m, 3).
+            :param percentiles: the percentiles of the distances to compute, in [0, 100], e.g. [50, 95, 99]. They are
+            interpolated linearly, as numpy.percentile does.
+            :param return_distances: Whether the distance of each query point should be returned. If False, None is returned
+            in their place.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple with a dict of reductions of the distances ('mean', 'rms', 'min' and 'max', 'max' being the
+            one-sided Hausdorff distance), an array of the requested percentiles and the array (m,) of the distance of each
+            query point (or None).
+        )");
+    m.def(
+        "chamfer_distance", &pgeof::chamfer_distance<float>, "a"_a.noconvert(), "b"_a.noconvert(),
+        "backend"_a = "nanoflann", R"(
+            Compute the Chamfer distance between two point clouds, i.e. the mean square distance from each point of 'a' to
+            its nearest point of 'b' plus the mean square distance from each point of 'b' to its nearest point of 'a'
+            (float precision version).
+
+            :param a: the first point cloud. A numpy array of shape (n, 3).
+            :param b: the second point cloud. A numpy array of shape (m, 3).
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the Chamfer distance.
+        )");
+    m.def(
+        "chamfer_distance", &pgeof::chamfer_distance<double>, "a"_a.noconvert(), "b"_a.noconvert(),
+        "backend"_a = "nanoflann", R"(
+            Compute the Chamfer distance between two point clouds, i.e. the mean square distance from each point of 'a' to
+            its nearest point of 'b' plus the mean square distance from each point of 'b' to its nearest point of 'a'
+            (double precision version).
+
+            :param a: the first point cloud. A numpy array of shape (n, 3).
+            :param b: the second point cloud. A numpy array of shape (m, 3).
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the Chamfer distance.
+        )");
+    m.def(
+        "m3c2", &pgeof::compute_m3c2<float>, "epoch1"_a.noconvert(), "epoch2"_a.noconvert(), "core_points"_a.noconvert(),
+        "normal_radius"_a, "cylinder_radius"_a, "max_depth"_a, "registration_error"_a = 0.0f, "backend"_a = "nanoflann",
+        R"(
+            Compute the M3C2 distance (Multiscale Model to Model Cloud Comparison, Lague et al. 2013) between two epochs of a
+            point cloud at a set of core points, in parallel (float precision version).
+
+            The normal of each core point is computed by PCA on the first epoch points within 'normal_radius'. The points of
+            each epoch lying in the cylinder of radius 'cylinder_radius' and half length 'max_depth' along this normal are
+            projected on its axis, the distance being the difference between their mean positions.
+
+            :param epoch1: the reference point cloud. A numpy array of shape (n, 3).
+            :param epoch2: the compared point cloud. A numpy array of shape (m, 3).
+            :param core_points: the points where the distance is computed, e.g. a subsampling of epoch1. A numpy array of
+            shape (c, 3).
+            :param normal_radius: the radius of the normal computation (projection scale).
+            :param cylinder_radius: the radius of the projection cylinder.
+            :param max_depth: the half length of the projection cylinder.
+            :param registration_error: the registration error between the two epochs, added to the level of detection.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple of arrays, the distances (c,), the levels of detection at 95% (c,)
+            '1.96 * (sqrt(std_1² / n_1 + std_2² / n_2) + registration_error)', the normals (c, 3) oriented towards +z and
+            the number of points of each epoch in each cylinder (c, 2). Distances are NaN if a cylinder is empty in one of
+            the epochs, levels of detection are NaN if it holds less than 2 points, and all are NaN if the normal
+            neighborhood holds less than 3 points.
+        )");
+    m.def(
+        "m3c2", &pgeof::compute_m3c2<double>, "epoch1"_a.noconvert(), "epoch2"_a.noconvert(), "core_points"_a.noconvert(),
+        "normal_radius"_a, "cylinder_radius"_a, "max_depth"_a, "registration_error"_a = 0.0, "backend"_a = "nanoflann",
+        R"(
+            Compute the M3C2 distance (Multiscale Model to Model Cloud Comparison, Lague et al. 2013) between two epochs of a
+            point cloud at a set of core points, in parallel (double precision version).
+
+            The normal of each core point is computed by PCA on the first epoch points within 'normal_radius'. The points of
+            each epoch lying in the cylinder of radius 'cylinder_radius' and half length 'max_depth' along this normal are
+            projected on its axis, the distance being the difference between their mean positions.
+
+            :param epoch1: the reference point cloud. A numpy array of shape (n, 3).
+            :param epoch2: the compared point cloud. A numpy array of shape (m, 3).
+            :param core_points: the points where the distance is computed, e.g. a subsampling of epoch1. A numpy array of
+            shape (c, 3).
+            :param normal_radius: the radius of the normal computation (projection scale).
+            :param cylinder_radius: the radius of the projection cylinder.
+            :param max_depth: the half length of the projection cylinder.
+            :param registration_error: the registration error between the two epochs, added to the level of detection.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple of arrays, the distances (c,), the levels of detection at 95% (c,)
+            '1.96 * (sqrt(std_1² / n_1 + std_2² / n_2) + registration_error)', the normals (c, 3) oriented towards +z and
+            the number of points of each epoch in each cylinder (c, 2). Distances are NaN if a cylinder is empty in one of
+            the epochs, levels of detection are NaN if it holds less than 2 points, and all are NaN if the normal
+            neighborhood holds less than 3 points.
+        )");
+    m.def(
+        "orient_normals", &pgeof::orient_normals_propagation<float>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "nn"_a.noconvert(), "nn_ptr"_a.noconvert(), R"(
+            Orient normals consistently by propagation over a neighborhood graph (Hoppe et al. 1992), float precision
+            version.
+
+            Normals are propagated along the minimum spanning forest of the graph weighted by '1 - |n_i . n_j|', computed in
+            parallel with the Borůvka algorithm. The highest point of each connected component is oriented towards +z, and
+            the forest is traversed in parallel breadth-first order from it.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the unoriented normals, e.g. the Normal_x, Normal_y and Normal_z features. A numpy array of shape
+            (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'. The graph does not need to be symmetric.
+            :return: the oriented normals in a (n, 3) numpy array.
+        )");
+    m.def(
+        "orient_normals", &pgeof::orient_normals_viewpoint<float>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "viewpoint"_a, R"(
+            Orient normals towards a viewpoint, e.g. the position of the scanner (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the unoriented normals. A numpy array of shape (n, 3).
+            :param viewpoint: the (x, y, z) position the normals should point to.
+            :return: the oriented normals in a (n, 3) numpy array.
+        )");
+    m.def(
+        "orient_normals", &pgeof::orient_normals_propagation<double>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "nn"_a.noconvert(), "nn_ptr"_a.noconvert(), R"(
+            Orient normals consistently by propagation over a neighborhood graph (Hoppe et al. 1992), double precision
+            version.
+
+            Normals are propagated along the minimum spanning forest of the graph weighted by '1 - |n_i . n_j|', computed in
+            parallel with the Borůvka algorithm. The highest point of each connected component is oriented towards +z, and
+            the forest is traversed in parallel breadth-first order from it.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the unoriented normals, e.g. the Normal_x, Normal_y and Normal_z features. A numpy array of shape
+            (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'. The graph does not need to be symmetric.
+            :return: the oriented normals in a (n, 3) numpy array.
+        )");
+    m.def(
+        "orient_normals", &pgeof::orient_normals_viewpoint<double>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "viewpoint"_a, R"(
+            Orient normals towards a viewpoint, e.g. the position of the scanner (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the unoriented normals. A numpy array of shape (n, 3).
+            :param viewpoint: the (x, y, z) position the normals should point to.
+            :return: the oriented normals in a (n, 3) numpy array.
+        )");
+    m.def(
+        "compute_fpfh", &pgeof::compute_fpfh_csr<float>, "xyz"_a.noconvert(), "normals"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), R"(
+            Compute the FPFH descriptors (Fast Point Feature Histograms, Rusu et al. 2009) of a point cloud from oriented
+            normals and a precomputed list of neighbors (float precision version).
+
+            Each descriptor is made of 3 histograms of 11 bins (alpha, phi and theta angles), as in PCL and Open3D. The
+            point itself is ignored in its neighbors.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the normals, e.g. oriented with orient_normals. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :return: the descriptors in a (n, 33) numpy array.
+        )");
+    m.def(
+        "compute_fpfh", &pgeof::compute_fpfh_radius<float>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "search_radius"_a, "max_knn"_a, "backend"_a = "nanoflann", R"(
+            Compute the FPFH descriptors (Fast Point Feature Histograms, Rusu et al. 2009) of a point cloud from oriented
+            normals and the neighbors within a radius of each point (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the normals, e.g. oriented with orient_normals. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the descriptors in a (n, 33) numpy array.
+        )");
+    m.def(
+        "compute_fpfh", &pgeof::compute_fpfh_csr<double>, "xyz"_a.noconvert(), "normals"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), R"(
+            Compute the FPFH descriptors (Fast Point Feature Histograms, Rusu et al. 2009) of a point cloud from oriented
+            normals and a precomputed list of neighbors (double precision version).
+
+            Each descriptor is made of 3 histograms of 11 bins (alpha, phi and theta angles), as in PCL and Open3D. The
+            point itself is ignored in its neighbors.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the normals, e.g. oriented with orient_normals. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :return: the descriptors in a (n, 33) numpy array.
+        )");
+    m.def(
+        "compute_fpfh", &pgeof::compute_fpfh_radius<double>, "xyz"_a.noconvert(), "normals"_a.noconvert(),
+        "search_radius"_a, "max_knn"_a, "backend"_a = "nanoflann", R"(
+            Compute the FPFH descriptors (Fast Point Feature Histograms, Rusu et al. 2009) of a point cloud from oriented
+            normals and the neighbors within a radius of each point (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param normals: the normals, e.g. oriented with orient_normals. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the descriptors in a (n, 33) numpy array.
+        )");
+    m.def(
+        "compute_normal_features", &pgeof::compute_normal_features_csr<float>, "xyz"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "k_small"_a, "k_min"_a = 1, R"(
+            Compute the normals of a point cloud and their second order features from a precomputed list of neighbors, in
+            two parallel stages over the same neighborhoods (float precision version).
+
+            * The following features are computed:
+                - normal (x, y, z), oriented towards +z
+                - normal variation: the mean angle (radians) between the normal and the normals of the neighbors
+                - normal change: the angle (radians) between the normal and the normal of the first k_small neighbors
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param k_small: the number of neighbors of the smaller scale. Neighbors should be sorted by distance, as returned
+            by knn_search.
+            :param k_min: the minimum number of neighbors to compute the features of a point. Points with less neighbors have
+            null features.
+            :return: the features in a (n, 5) numpy array.
+        )");
+    m.def(
+        "compute_normal_features", &pgeof::compute_normal_features_radius<float>, "xyz"_a.noconvert(),
+        "search_radius"_a, "small_radius"_a, "max_knn"_a, "k_min"_a = 1, "backend"_a = "nanoflann", R"(
+            Compute the normals of a point cloud and their second order features from a radius search, in two parallel
+            stages over the same neighborhoods (float precision version).
+
+            * The following features are computed:
+                - normal (x, y, z), oriented towards +z
+                - normal variation: the mean angle (radians) between the normal and the normals of the neighbors
+                - normal change: the angle (radians) between the normal and the normal of the neighbors within small_radius
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param small_radius: the radius of the smaller scale, lower than the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param k_min: the minimum number of neighbors to compute the features of a point. Points with less neighbors have
+            null features.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the features in a (n, 5) numpy array.
+        )");
+    m.def(
+        "compute_normal_features", &pgeof::compute_normal_features_csr<double>, "xyz"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "k_small"_a, "k_min"_a = 1, R"(
+            Compute the normals of a point cloud and their second order features from a precomputed list of neighbors, in
+            two parallel stages over the same neighborhoods (double precision version).
+
+            * The following features are computed:
+                - normal (x, y, z), oriented towards +z
+                - normal variation: the mean angle (radians) between the normal and the normals of the neighbors
+                - normal change: the angle (radians) between the normal and the normal of the first k_small neighbors
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param k_small: the number of neighbors of the smaller scale. Neighbors should be sorted by distance, as returned
+            by knn_search.
+            :param k_min: the minimum number of neighbors to compute the features of a point. Points with less neighbors have
+            null features.
+            :return: the features in a (n, 5) numpy array.
+        )");
+    m.def(
+        "compute_normal_features", &pgeof::compute_normal_features_radius<double>, "xyz"_a.noconvert(),
+        "search_radius"_a, "small_radius"_a, "max_knn"_a, "k_min"_a = 1, "backend"_a = "nanoflann", R"(
+            Compute the normals of a point cloud and their second order features from a radius search, in two parallel
+            stages over the same neighborhoods (double precision version).
+
+            * The following features are computed:
+                - normal (x, y, z), oriented towards +z
+                - normal variation: the mean angle (radians) between the normal and the normals of the neighbors
+                - normal change: the angle (radians) between the normal and the normal of the neighbors within small_radius
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param small_radius: the radius of the smaller scale, lower than the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param k_min: the minimum number of neighbors to compute the features of a point. Points with less neighbors have
+            null features.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the features in a (n, 5) numpy array.
+        )");
+    m.def(
+        "neighborhood_statistics", &pgeof::neighborhood_statistics_csr<float>, "attributes"_a, "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "statistics"_a = std::vector<std::string>{"mean", "std"}, R"(
+            Compute statistics of per-point attributes over neighborhoods given in CSR format, in parallel (float precision
+            version).
+
+            :param attributes: the per-point attributes, e.g. intensity, return number or RGB. A numpy array of shape (n, c).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param statistics: a list of 'mean', 'std' (population standard deviation), 'min', 'max' or 'median'.
+            :return: the statistics of each neighborhood in a (n, n_statistics, c) numpy array. Statistics of empty
+            neighborhoods are NaN.
+        )");
+    m.def(
+        "neighborhood_statistics", &pgeof::neighborhood_statistics_radius<float>, "xyz"_a.noconvert(), "attributes"_a,
+        "search_radius"_a, "max_knn"_a, "statistics"_a = std::vector<std::string>{"mean", "std"},
+        "backend"_a = "nanoflann", R"(
+            Compute statistics of per-point attributes over the neighbors within a radius of each point, in parallel
+            (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param attributes: the per-point attributes, e.g. intensity, return number or RGB. A numpy array of shape (n, c).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param statistics: a list of 'mean', 'std' (population standard deviation), 'min', 'max' or 'median'.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the statistics of each neighborhood in a (n, n_statistics, c) numpy array.
+        )");
+    m.def(
+        "neighborhood_statistics", &pgeof::neighborhood_statistics_csr<double>, "attributes"_a, "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "statistics"_a = std::vector<std::string>{"mean", "std"}, R"(
+            Compute statistics of per-point attributes over neighborhoods given in CSR format, in parallel (double precision
+            version).
+
+            :param attributes: the per-point attributes, e.g. intensity, return number or RGB. A numpy array of shape (n, c).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param statistics: a list of 'mean', 'std' (population standard deviation), 'min', 'max' or 'median'.
+            :return: the statistics of each neighborhood in a (n, n_statistics, c) numpy array. Statistics of empty
+            neighborhoods are NaN.
+        )");
+    m.def(
+        "neighborhood_statistics", &pgeof::neighborhood_statistics_radius<double>, "xyz"_a.noconvert(), "attributes"_a,
+        "search_radius"_a, "max_knn"_a, "statistics"_a = std::vector<std::string>{"mean", "std"},
+        "backend"_a = "nanoflann", R"(
+            Compute statistics of per-point attributes over the neighbors within a radius of each point, in parallel
+            (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param attributes: the per-point attributes, e.g. intensity, return number or RGB. A numpy array of shape (n, c).
+            :param search_radius: the search radius.
+            :param max_knn: the maximum number of neighbors to fetch inside the radius. The central point is included.
+            :param statistics: a list of 'mean', 'std' (population standard deviation), 'min', 'max' or 'median'.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the statistics of each neighborhood in a (n, n_statistics, c) numpy array.
+        )");
+    m.def(
+        "statistical_outlier_filter", &pgeof::statistical_outlier_filter<float>, "xyz"_a.noconvert(), "k"_a = 20,
+        "std_ratio"_a = 2.0, "return_indices"_a = false, "return_neighbors"_a = false, "backend"_a = "nanoflann", R"(
+            Statistical outlier removal: a point is an outlier if the mean distance to its k nearest neighbors is greater than
+            mean + std_ratio * std over all the points. The mean distances are computed during a parallel kNN search, no
+            distance matrix is stored (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param k: the number of neighbors of each point, the point itself excluded.
+            :param std_ratio: the number of standard deviations above the mean beyond which a point is an outlier.
+            :param return_indices: Whether the inliers are returned as sorted indices rather than as a boolean mask.
+            :param return_neighbors: Whether the neighbors of the inliers are returned. If False, None is returned in their
+            place.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple: the inliers (a boolean mask of shape (n,) or uint32 indices), and 'nn', 'nn_ptr' the neighbors
+            of the inliers in CSR format, indexed as xyz[inliers], each point being its own first neighbor. They can directly
+            be used by the feature computation functions on xyz[inliers].
+        )");
+    m.def(
+        "radius_outlier_filter", &pgeof::radius_outlier_filter<float>, "xyz"_a.noconvert(), "search_radius"_a,
+        "min_neighbors"_a, "return_indices"_a = false, "return_neighbors"_a = false, "max_knn"_a = 64,
+        "backend"_a = "nanoflann", R"(
+            Radius outlier removal: a point is an outlier if it has less than min_neighbors neighbors within a radius. The
+            neighbors are counted during a parallel radius search, which stops as soon as min_neighbors are found
+            (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param min_neighbors: the minimum number of neighbors of an inlier, the point itself excluded.
+            :param return_indices: Whether the inliers are returned as sorted indices rather than as a boolean mask.
+            :param return_neighbors: Whether the neighbors of the inliers are returned. If False, None is returned in their
+            place.
+            :param max_knn: the maximum number of neighbors kept per point if they are returned, at least min_neighbors.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple: the inliers (a boolean mask of shape (n,) or uint32 indices), and 'nn', 'nn_ptr' the neighbors
+            of the inliers in CSR format, indexed as xyz[inliers], each point being its own first neighbor. They can directly
+            be used by the feature computation functions on xyz[inliers].
+        )");
+    m.def(
+        "statistical_outlier_filter", &pgeof::statistical_outlier_filter<double>, "xyz"_a.noconvert(), "k"_a = 20,
+        "std_ratio"_a = 2.0, "return_indices"_a = false, "return_neighbors"_a = false, "backend"_a = "nanoflann", R"(
+            Statistical outlier removal: a point is an outlier if the mean distance to its k nearest neighbors is greater than
+            mean + std_ratio * std over all the points. The mean distances are computed during a parallel kNN search, no
+            distance matrix is stored (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param k: the number of neighbors of each point, the point itself excluded.
+            :param std_ratio: the number of standard deviations above the mean beyond which a point is an outlier.
+            :param return_indices: Whether the inliers are returned as sorted indices rather than as a boolean mask.
+            :param return_neighbors: Whether the neighbors of the inliers are returned. If False, None is returned in their
+            place.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple: the inliers (a boolean mask of shape (n,) or uint32 indices), and 'nn', 'nn_ptr' the neighbors
+            of the inliers in CSR format, indexed as xyz[inliers], each point being its own first neighbor. They can directly
+            be used by the feature computation functions on xyz[inliers].
+        )");
+    m.def(
+        "radius_outlier_filter", &pgeof::radius_outlier_filter<double>, "xyz"_a.noconvert(), "search_radius"_a,
+        "min_neighbors"_a, "return_indices"_a = false, "return_neighbors"_a = false, "max_knn"_a = 64,
+        "backend"_a = "nanoflann", R"(
+            Radius outlier removal: a point is an outlier if it has less than min_neighbors neighbors within a radius. The
+            neighbors are counted during a parallel radius search, which stops as soon as min_neighbors are found
+            (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius.
+            :param min_neighbors: the minimum number of neighbors of an inlier, the point itself excluded.
+            :param return_indices: Whether the inliers are returned as sorted indices rather than as a boolean mask.
+            :param return_neighbors: Whether the neighbors of the inliers are returned. If False, None is returned in their
+            place.
+            :param max_knn: the maximum number of neighbors kept per point if they are returned, at least min_neighbors.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: a tuple: the inliers (a boolean mask of shape (n,) or uint32 indices), and 'nn', 'nn_ptr' the neighbors
+            of the inliers in CSR format, indexed as xyz[inliers], each point being its own first neighbor. They can directly
+            be used by the feature computation functions on xyz[inliers].
+        )");
+    m.def(
+        "farthest_point_sampling", &pgeof::farthest_point_sampling<float>, "xyz"_a.noconvert(), "n_samples"_a,
+        "start_index"_a = 0, "voxel_size"_a = 0.0, R"(
+            Farthest point sampling (FPS): each sample is the point the farthest from the previous samples. The distances
+            to the samples are updated in parallel over blocks of points, followed by a deterministic argmax (float precision
+            version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param n_samples: the number of samples, at most n.
+            :param start_index: the index of the first sample.
+            :param voxel_size: if > 0, approximate sampling among one point per occupied voxel of this size (the closest to
+            the voxel center), much faster on dense point clouds. There should be at least n_samples occupied voxels.
+            :return: the indices of the samples, in their order of selection. A uint32 numpy array of shape (n_samples,).
+        )");
+    m.def(
+        "farthest_point_sampling", &pgeof::farthest_point_sampling<double>, "xyz"_a.noconvert(), "n_samples"_a,
+        "start_index"_a = 0, "voxel_size"_a = 0.0, R"(
+            Farthest point sampling (FPS): each sample is the point the farthest from the previous samples. The distances
+            to the samples are updated in parallel over blocks of points, followed by a deterministic argmax (double precision
+            version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param n_samples: the number of samples, at most n.
+            :param start_index: the index of the first sample.
+            :param voxel_size: if > 0, approximate sampling among one point per occupied voxel of this size (the closest to
+            the voxel center), much faster on dense point clouds. There should be at least n_samples occupied voxels.
+            :return: the indices of the samples, in their order of selection. A uint32 numpy array of shape (n_samples,).
+        )");
+    m.def(
+        "dbscan", &pgeof::dbscan<float>, "xyz"_a.noconvert(), "eps"_a, "min_points"_a = 5, "min_cluster_size"_a = 1,
+        "mask"_a = nb::none(), "backend"_a = "nanoflann", R"(
+            Cluster a point cloud with DBSCAN, in parallel: core points are counted with a radius search, then merged with
+            their core neighbors in a lock-free union-find during a second radius search. No neighbor is stored. With
+            min_points=1, it is an Euclidean cluster extraction (connected components within eps) (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param eps: the radius of the neighborhoods.
+            :param min_points: the minimum number of points within eps of a core point, itself included.
+            :param min_cluster_size: the clusters with less points are labeled as noise.
+            :param mask: optional boolean numpy array of shape (n,), the points to cluster, e.g. selected from their features.
+            The other points are labeled as noise and ignored.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the cluster label of each point, -1 for the noise. An int32 numpy array of shape (n,). Border points
+            join the cluster of their lowest core neighbor, so the labels are deterministic.
+        )");
+    m.def(
+        "dbscan", &pgeof::dbscan<double>, "xyz"_a.noconvert(), "eps"_a, "min_points"_a = 5, "min_cluster_size"_a = 1,
+        "mask"_a = nb::none(), "backend"_a = "nanoflann", R"(
+            Cluster a point cloud with DBSCAN, in parallel: core points are counted with a radius search, then merged with
+            their core neighbors in a lock-free union-find during a second radius search. No neighbor is stored. With
+            min_points=1, it is an Euclidean cluster extraction (connected components within eps) (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param eps: the radius of the neighborhoods.
+            :param min_points: the minimum number of points within eps of a core point, itself included.
+            :param min_cluster_size: the clusters with less points are labeled as noise.
+            :param mask: optional boolean numpy array of shape (n,), the points to cluster, e.g. selected from their features.
+            The other points are labeled as noise and ignored.
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :return: the cluster label of each point, -1 for the noise. An int32 numpy array of shape (n,). Border points
+            join the cluster of their lowest core neighbor, so the labels are deterministic.
+        )");
+    m.def(
+        "region_growing", &pgeof::region_growing<float>, "normals"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "max_angle"_a, "feature"_a = nb::none(), "min_feature"_a = -std::numeric_limits<float>::infinity(),
+        "max_feature_difference"_a = std::numeric_limits<float>::infinity(), "min_region_size"_a = 1, R"(
+            Segment a point cloud into smooth regions over a neighborhood graph in CSR format. Neighbors are merged if the
+            angle between their normals and the difference of their features are small enough, with a lock-free union-find
+            in parallel over the points (float precision version).
+
+            :param normals: the normals of the points, unoriented. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param max_angle: the maximum angle (radians, in [0, pi/2]) between the normals of two neighbors of a region.
+            :param feature: optional feature of the points, e.g. their planarity. A numpy array of shape (n,).
+            :param min_feature: the points with a lower feature do not belong to any region.
+            :param max_feature_difference: the maximum difference between the features of two neighbors of a region.
+            :param min_region_size: the regions with less points are labeled as -1.
+            :return: the region label of each point, -1 for the points of no region. An int32 numpy array of shape (n,).
+            Regions are numbered by increasing lowest point index, they do not depend on a seed order.
+        )");
+    m.def(
+        "region_growing", &pgeof::region_growing<double>, "normals"_a.noconvert(), "nn"_a.noconvert(),
+        "nn_ptr"_a.noconvert(), "max_angle"_a, "feature"_a = nb::none(), "min_feature"_a = -std::numeric_limits<double>::infinity(),
+        "max_feature_difference"_a = std::numeric_limits<double>::infinity(), "min_region_size"_a = 1, R"(
+            Segment a point cloud into smooth regions over a neighborhood graph in CSR format. Neighbors are merged if the
+            angle between their normals and the difference of their features are small enough, with a lock-free union-find
+            in parallel over the points (double precision version).
+
+            :param normals: the normals of the points, unoriented. A numpy array of shape (n, 3).
+            :param nn: Integer 1D array. Flattened neighbor indices. Make sure those are all positive.
+            :param nn_ptr: [n_points+1] Integer 1D array. Pointers wrt 'nn'.
+            :param max_angle: the maximum angle (radians, in [0, pi/2]) between the normals of two neighbors of a region.
+            :param feature: optional feature of the points, e.g. their planarity. A numpy array of shape (n,).
+            :param min_feature: the points with a lower feature do not belong to any region.
+            :param max_feature_difference: the maximum difference between the features of two neighbors of a region.
+            :param min_region_size: the regions with less points are labeled as -1.
+            :return: the region label of each point, -1 for the points of no region. An int32 numpy array of shape (n,).
+            Regions are numbered by increasing lowest point index, they do not depend on a seed order.
+        )");
     m.def(
         "compute_features_selected", &pgeof::compute_geometric_features_selected<double>, "xyz"_a.noconvert(),
-        "search_radius"_a, "max_knn"_a, "selected_features"_a, R"(
+        "search_radius"_a, "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
             Compute a selected set of geometric features for a point cloud via radius search.
 
             This function aims to mimick the behavior of jakteristics and provide an efficient way
@@ -158,11 +1102,22 @@ NB_MODULE(pgeof_ext, m)
             :param max_knn: the maximum number of neighbors to fetch inside the sphere. The central point is included. Fixing a
             reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
             :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over each
+            neighborhood are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
             :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+            If attributes are given, their statistics are appended as (num_points, n_statistics * c) columns, statistic by
+            statistic.
         )");
     m.def(
         "compute_features_selected", &pgeof::compute_geometric_features_selected<float>, "xyz"_a.noconvert(),
-        "search_radius"_a, "max_knn"_a, "selected_features"_a, R"(
+        "search_radius"_a, "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
             Compute a selected set of geometric features for a point cloud via radius search.
 
             This function aims to mimic the behavior of jakteristics and provide an efficient way
@@ -173,6 +1128,119 @@ NB_MODULE(pgeof_ext, m)
             :param max_knn: the maximum number of neighbors to fetch inside the sphere. The central point is included. Fixing a
             reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
             :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over each
+            neighborhood are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
             :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+            If attributes are given, their statistics are appended as (num_points, n_statistics * c) columns, statistic by
+            statistic.
+        )");
+    m.def(
+        "compute_features_selected_adaptive", &pgeof::compute_geometric_features_selected_adaptive<double>,
+        "xyz"_a.noconvert(),
+        "search_radius"_a.noconvert(), "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
+            Compute a selected set of geometric features for a point cloud via radius search, each point having its own
+            search radius (double precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius of each point. A numpy array of shape (n,).
+            :param max_knn: the maximum number of neighbors to fetch inside the sphere. The central point is included. Fixing a
+            reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+            :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over each
+            neighborhood are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+            If attributes are given, their statistics are appended as (num_points, n_statistics * c) columns, statistic by
+            statistic.
+        )");
+    m.def(
+        "compute_features_selected_adaptive", &pgeof::compute_geometric_features_selected_adaptive<float>,
+        "xyz"_a.noconvert(),
+        "search_radius"_a.noconvert(), "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
+            Compute a selected set of geometric features for a point cloud via radius search, each point having its own
+            search radius (float precision version).
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param search_radius: the search radius of each point. A numpy array of shape (n,).
+            :param max_knn: the maximum number of neighbors to fetch inside the sphere. The central point is included. Fixing a
+            reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+            :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over each
+            neighborhood are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, features_count) numpy array.
+            If attributes are given, their statistics are appended as (num_points, n_statistics * c) columns, statistic by
+            statistic.
+        )");
+    m.def(
+        "compute_features_selected", &pgeof::compute_geometric_features_selected_multiradius<double>,
+        "xyz"_a.noconvert(), "radii"_a, "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<double, 3>{1.0, 1.0, 1.0}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
+            Compute a selected set of geometric features for a point cloud at multiple radii from a single
+            radius search (double precision version).
+
+            Neighbors are searched once at the largest radius, sorted by distance, and the features of each
+            radius are computed from the prefixes of this list.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param radii: the search radii, sorted in ascending order.
+            :param max_knn: the maximum number of neighbors to fetch inside each sphere. The central point is included.
+            Fixing a reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+            :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over the
+            neighborhood of each radius are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, n_radii, features_count)
+            numpy array. If attributes are given, their statistics are appended to the features of each radius as
+            n_statistics * c columns, statistic by statistic.
+        )");
+    m.def(
+        "compute_features_selected", &pgeof::compute_geometric_features_selected_multiradius<float>,
+        "xyz"_a.noconvert(), "radii"_a, "max_knn"_a, "selected_features"_a, "backend"_a = "nanoflann",
+        "weights"_a = std::array<float, 3>{1.0f, 1.0f, 1.0f}, "attributes"_a = nb::none(),
+        "statistics"_a = std::vector<std::string>{"mean"}, R"(
+            Compute a selected set of geometric features for a point cloud at multiple radii from a single
+            radius search (float precision version).
+
+            Neighbors are searched once at the largest radius, sorted by distance, and the features of each
+            radius are computed from the prefixes of this list.
+
+            :param xyz: the point cloud. A numpy array of shape (n, 3).
+            :param radii: the search radii, sorted in ascending order.
+            :param max_knn: the maximum number of neighbors to fetch inside each sphere. The central point is included.
+            Fixing a reasonable max number of neighbors prevents running OOM for large radius/dense point clouds.
+            :param selected_features: List of selected features. See EFeatureID
+            :param backend: the KD-tree implementation. 'nanoflann' or 'implicit', a pointer-free KD-tree stored in flat arrays
+            with the points copied in leaf order.
+            :param weights: the weight of each axis (x, y, z) in the square distances of the neighbor search, e.g. (1, 1, 4)
+            for z distances counting twice. Features are computed in the original coordinates.
+            :param attributes: optional per-point attributes (e.g. intensity, return number, RGB), whose statistics over the
+            neighborhood of each radius are computed from the same search. A numpy array of shape (n, c).
+            :param statistics: the statistics of the attributes, a list of 'mean', 'std', 'min', 'max' or 'median'.
+            :return: Geometric features associated with each point's neighborhood in a (num_points, n_radii, features_count)
+            numpy array. If attributes are given, their statistics are appended to the features of each radius as
+            n_statistics * c columns, statistic by statistic.
         )");
 }
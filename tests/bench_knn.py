@@ -31,6 +31,16 @@ def test_knn_pgeof(benchmark, random_point_cloud):
     benchmark(_to_bench)
 
 
+@pytest.mark.benchmark(group="knn", disable_gc=True, warmup=True)
+def test_knn_pgeof_implicit(benchmark, random_point_cloud):
+    knn = 50
+
+    def _to_bench():
+        _ = pgeof.knn_search(random_point_cloud, random_point_cloud, knn, backend="implicit")
+
+    benchmark(_to_bench)
+
+
 @pytest.mark.benchmark(group="radius-search", disable_gc=True, warmup=True)
 def test_radius_scipy(benchmark, random_point_cloud):
     max_knn = 30
@@ -52,3 +62,14 @@ def test_radius_pgeof(benchmark, random_point_cloud):
         _ = pgeof.radius_search(random_point_cloud, random_point_cloud, radius, max_knn)
 
     benchmark(_to_bench)
+
+
+@pytest.mark.benchmark(group="radius-search", disable_gc=True, warmup=True)
+def test_radius_pgeof_implicit(benchmark, random_point_cloud):
+    max_knn = 30
+    radius = 0.2
+
+    def _to_bench():
+        _ = pgeof.radius_search(random_point_cloud, random_point_cloud, radius, max_knn, backend="implicit")
+
+    benchmark(_to_bench)
@@ -0,0 +1,36 @@
+import numpy as np
+import pytest
+
+import pgeof
+from tests.helpers import random_nn
+
+
+@pytest.fixture(scope="module")
+def random_neighborhoods():
+    return random_nn(100000, 100)
+
+
+@pytest.mark.parametrize("search", ["exhaustive", "coarse_to_fine", "log"])
+@pytest.mark.benchmark(group="optimal-search", disable_gc=True, warmup=True)
+def test_optimal_search(benchmark, random_neighborhoods, search):
+    xyz, nn, nn_ptr = random_neighborhoods
+
+    def _to_bench():
+        _ = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_min_search=10, search=search)
+
+    benchmark(_to_bench)
+
+
+@pytest.mark.parametrize("k_step", [1, 5])
+def test_optimal_search_agreement(random_neighborhoods, k_step):
+    # Report how often the approximate sweeps select another neighborhood size than the exhaustive one
+    xyz, nn, nn_ptr = random_neighborhoods
+    exhaustive = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_step=k_step, k_min_search=10)
+    for search in ["coarse_to_fine", "log"]:
+        fast = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_step=k_step, k_min_search=10, search=search)
+        differs = fast[:, 11] != exhaustive[:, 11]
+        k_gap = np.abs(fast[differs, 11] - exhaustive[differs, 11])
+        print(
+            f"\nk_step={k_step} search={search}: optimal size differs for {differs.mean():.2%} of the points"
+            + (f" (mean gap {k_gap.mean():.1f} neighbors)" if differs.any() else "")
+        )
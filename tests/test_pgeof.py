@@ -1,7 +1,9 @@
 import numpy as np
+import pytest
 from scipy.spatial import KDTree
 
 import pgeof
+from pgeof import EFeatureID
 from tests.helpers import random_nn
 
 
@@ -44,3 +46,473 @@ def test_pgeof_multiscale():
     multi_simple = pgeof.compute_features_multiscale(xyz, nn, nn_ptr, [20], False)
     np.testing.assert_allclose(multi[:, 0], multi_simple[:, 0], 1e-1, 1e-5)
     np.testing.assert_allclose(multi[:, 1], simple, 1e-1, 1e-5)
+
+
+def test_pgeof_selected_radius():
+    max_knn = 20
+    radius = 0.1
+    rng = np.random.default_rng()
+    xyz = rng.random(size=(2000, 3), dtype=np.float32)
+    # Reference: features from the CSR conversion of a radius search
+    knn, _ = pgeof.radius_search(xyz, xyz, radius, max_knn)
+    nn_ptr = np.r_[0, (knn >= 0).sum(axis=1).cumsum()].astype("uint32")
+    nn = knn[knn >= 0].astype("uint32")
+    simple = pgeof.compute_features(xyz, nn, nn_ptr, 2, False)
+    selected = [EFeatureID.Linearity, EFeatureID.Planarity, EFeatureID.Scattering]
+    on_the_fly = pgeof.compute_features_selected(xyz, radius, max_knn, selected)
+    np.testing.assert_allclose(on_the_fly, simple[:, [int(f) for f in selected]], 1e-3, 1e-3)
+
+
+def test_pgeof_selected_multiradius():
+    max_knn = 30
+    radii = [0.05, 0.1, 0.2]
+    rng = np.random.default_rng()
+    xyz = rng.random(size=(2000, 3), dtype=np.float32)
+    selected = [EFeatureID.Linearity, EFeatureID.Planarity, EFeatureID.Scattering, EFeatureID.Curvature]
+    multi = pgeof.compute_features_selected(xyz, radii=radii, max_knn=max_knn, selected_features=selected)
+    assert multi.shape == (xyz.shape[0], len(radii), len(selected))
+    for i_radius, radius in enumerate(radii):
+        single = pgeof.compute_features_selected(xyz, radius, max_knn, selected)
+        np.testing.assert_allclose(multi[:, i_radius], single, 1e-3, 1e-3)
+    # Radii given positionally as a numpy array are radii, even with one radius per point
+    positional = pgeof.compute_features_selected(xyz, np.array(radii, dtype=np.float32), max_knn, selected)
+    np.testing.assert_equal(positional, multi)
+    square = xyz[: len(radii)]
+    multi = pgeof.compute_features_selected(square, radii=radii, max_knn=2, selected_features=selected)
+    positional = pgeof.compute_features_selected(square, np.array(radii, dtype=np.float32), 2, selected)
+    np.testing.assert_equal(positional, multi)
+
+
+def test_pgeof_optimal_radius():
+    max_knn = 100
+    radii = np.array([0.1, 0.15, 0.2], dtype=np.float32)
+    rng = np.random.default_rng()
+    xyz = rng.random(size=(2000, 3), dtype=np.float32)
+    optimal = pgeof.compute_features_optimal_radius(xyz, radii, max_knn, 3)
+    assert optimal.shape == (xyz.shape[0], 12)
+    assert np.isin(optimal[:, 11], radii).all()
+    # Features should match the ones computed at the selected radius
+    selected = [EFeatureID.Linearity, EFeatureID.Planarity, EFeatureID.Scattering]
+    multi = pgeof.compute_features_selected(xyz, radii=radii, max_knn=max_knn, selected_features=selected)
+    i_optimal = np.searchsorted(radii, optimal[:, 11])
+    np.testing.assert_allclose(optimal[:, :3], multi[np.arange(xyz.shape[0]), i_optimal], 1e-3, 1e-3)
+
+
+def test_pgeof_optimal_exhaustive():
+    # Nearly planar neighborhoods, whose smallest eigenvalue is lost if the covariance is computed carelessly
+    num_points, k = 5000, 30
+    rng = np.random.default_rng()
+    xyz = np.zeros((num_points, 3), dtype=np.float32)
+    xyz[:, :2] = rng.uniform(0.0, 100.0, size=(num_points, 2))
+    xyz[:, 2] = rng.normal(0.0, 1e-3, size=num_points)
+    nn = KDTree(xyz).query(xyz, k=k)[1].astype(np.uint32)
+    nn_ptr = (np.arange(num_points + 1) * k).astype(np.uint32)
+    optimal = pgeof.compute_features_optimal(xyz, nn.flatten(), nn_ptr, k_step=2, k_min_search=10)
+    k_optimal = optimal[:, 11].astype(np.uint32)
+
+    # Baseline selection: lowest eigenentropy of the candidate neighborhoods, the smallest one on ties
+    eigenentropies = []
+    candidates = np.arange(10, k + 1, 2)
+    for k_candidate in candidates:
+        neighbors = xyz[nn[:, :k_candidate]].astype(np.float64)
+        centered = neighbors - neighbors.mean(axis=1, keepdims=True)
+        val = np.clip(np.linalg.eigvalsh(np.einsum("nki,nkj->nij", centered, centered) / k_candidate), 0.0, None)
+        e = val / (val.sum(axis=1, keepdims=True) + 1e-3)
+        eigenentropies.append(-(e * np.log(e + 1e-3)).sum(axis=1))
+    k_baseline = candidates[np.argmin(np.stack(eigenentropies, axis=1), axis=1)]
+    assert (k_optimal == k_baseline).mean() > 0.99
+
+    # Features are the ones of the baseline computation at the selected size
+    kept = np.arange(k)[None, :] < k_optimal[:, None]
+    nn_ptr_optimal = np.concatenate([[0], np.cumsum(k_optimal)]).astype(np.uint32)
+    baseline = pgeof.compute_features(xyz, nn[kept], nn_ptr_optimal)
+    np.testing.assert_equal(optimal[:, :11], baseline)
+
+
+def test_pgeof_optimal_search():
+    xyz, nn, nn_ptr = random_nn(10000, 50)
+    exhaustive = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_min_search=10)
+    for search in ["coarse_to_fine", "log"]:
+        fast = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_min_search=10, search=search)
+        assert ((fast[:, 11] >= 10) & (fast[:, 11] <= 50)).all()
+        # Points for which both strategies agree on the optimal size share the same features
+        same = fast[:, 11] == exhaustive[:, 11]
+        np.testing.assert_allclose(fast[same], exhaustive[same], 1e-5, 1e-5)
+    coarse_to_fine = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_min_search=10, search="coarse_to_fine")
+    assert (coarse_to_fine[:, 11] == exhaustive[:, 11]).mean() > 0.8
+
+
+def test_pgeof_optimal_criteria():
+    xyz, nn, nn_ptr = random_nn(10000, 50)
+    criteria = [
+        pgeof.EOptimalCriterion.Eigentropy,
+        pgeof.EOptimalCriterion.Dimensionality,
+        pgeof.EOptimalCriterion.CurvatureStability,
+    ]
+    reference = pgeof.compute_features_optimal(xyz, nn, nn_ptr, k_step=2, k_min_search=10)
+    features, k_optimal = pgeof.compute_features_optimal(xyz, nn, nn_ptr, criteria=criteria, k_step=2, k_min_search=10)
+    assert k_optimal.shape == (xyz.shape[0], len(criteria))
+    assert ((k_optimal >= 10) & (k_optimal <= 50)).all()
+    # The first criterion drives the features
+    np.testing.assert_equal(k_optimal[:, 0], reference[:, 11])
+    np.testing.assert_allclose(features, reference, 1e-5, 1e-5)
+
+
+def test_radius_search_adaptive():
+    max_knn = 30
+    rng = np.random.default_rng()
+    xyz = rng.random(size=(2000, 3), dtype=np.float32)
+    radius = rng.uniform(0.05, 0.15, size=xyz.shape[0]).astype(np.float32)
+    nn, nn_ptr, sq_dist = pgeof.radius_search(xyz, xyz, radius, max_knn)
+    assert nn_ptr.shape == (xyz.shape[0] + 1,)
+    assert nn.shape == sq_dist.shape == (nn_ptr[-1],)
+    tree = KDTree(xyz)
+    for i in range(0, xyz.shape[0], 97):
+        dist, k_legacy = tree.query(xyz[i], k=max_knn, distance_upper_bound=radius[i])
+        k_legacy = k_legacy[np.isfinite(dist)]
+        np.testing.assert_equal(np.sort(nn[nn_ptr[i] : nn_ptr[i + 1]]), np.sort(k_legacy))
+    # Neighbors in CSR format are directly usable by the feature computation
+    selected = [EFeatureID.Linearity, EFeatureID.Planarity, EFeatureID.Scattering]
+    simple = pgeof.compute_features(xyz, nn, nn_ptr, 2, False)
+    adaptive = pgeof.compute_features_selected_adaptive(xyz, radius, max_knn, selected)
+    np.testing.assert_allclose(adaptive, simple[:, [int(f) for f in selected]], 1e-3, 1e-3)
+
+
+def test_knn_search_variable_k():
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 200.0, size=(2000, 3)).astype(np.float32)
+    knn = rng.integers(10, 50, size=xyz.shape[0]).astype(np.uint32)
+    nn, nn_ptr, sq_dist = pgeof.knn_search(xyz, xyz, knn)
+    np.testing.assert_equal(np.diff(nn_ptr), knn)
+    assert nn.shape == sq_dist.shape == (knn.sum(),)
+    k_dense, _ = pgeof.knn_search(xyz, xyz, int(knn.max()))
+    for i in range(0, xyz.shape[0], 97):
+        np.testing.assert_equal(nn[nn_ptr[i] : nn_ptr[i + 1]], k_dense[i, : knn[i]])
+    # Neighbors in CSR format are directly usable by the feature computation
+    features = pgeof.compute_features(xyz, nn, nn_ptr)
+    assert features.shape == (xyz.shape[0], 11)
+
+
+def test_search_exclude_self():
+    knn = 10
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 200.0, size=(1000, 3)).astype(np.float32)
+    k_self, _ = pgeof.knn_search(xyz, xyz, knn + 1)
+    k_new, sq_dist = pgeof.knn_search(xyz, xyz, knn, return_distances=False, exclude_self=True)
+    assert sq_dist is None
+    np.testing.assert_equal(k_self[:, 1:], k_new)
+    r_new, sq_dist = pgeof.radius_search(xyz, xyz, 20.0, knn, return_distances=False, exclude_self=True)
+    assert sq_dist is None
+    assert not np.any(r_new == np.arange(xyz.shape[0])[:, None])
+    # A different point cloud, even with the same number of points, cannot be excluded from itself
+    with pytest.raises(ValueError):
+        pgeof.knn_search(xyz, xyz.copy(), knn, exclude_self=True)
+    with pytest.raises(ValueError):
+        pgeof.radius_search(xyz, xyz.copy(), 20.0, knn, exclude_self=True)
+
+
+def test_knn_graph():
+    knn = 10
+    max_distance = 8.0
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 100.0, size=(2000, 3)).astype(np.float32)
+    k_dense, sq_dist = pgeof.knn_search(xyz, xyz, knn)
+    n = xyz.shape[0]
+    keep = sq_dist.ravel() <= max_distance**2
+    rows = np.repeat(np.arange(n), knn)[keep]
+    cols = k_dense.ravel().astype(np.int64)[keep]
+    directed = set(zip(rows.tolist(), cols.tolist()))
+    reversed_ = {(j, i) for i, j in directed}
+    expected = {"directed": directed, "symmetric": directed | reversed_, "mutual": directed & reversed_}
+    for mode, edges in expected.items():
+        nn, nn_ptr, graph_sq_dist = pgeof.knn_graph(k_dense, sq_dist, mode=mode, max_distance=max_distance)
+        assert nn.shape == graph_sq_dist.shape
+        graph_rows = np.repeat(np.arange(n), np.diff(nn_ptr))
+        assert set(zip(graph_rows.tolist(), nn.tolist())) == edges
+        np.testing.assert_allclose(graph_sq_dist, ((xyz[graph_rows] - xyz[nn]) ** 2).sum(axis=1), rtol=1e-5, atol=1e-5)
+    # CSR input, without distances
+    nn_ptr = np.arange(n + 1, dtype=np.uint32) * knn
+    nn, nn_ptr, graph_sq_dist = pgeof.knn_graph(k_dense.ravel(), nn_ptr, mode="symmetric")
+    assert graph_sq_dist is None
+    features = pgeof.compute_features(xyz, nn, nn_ptr)
+    assert features.shape == (n, 11)
+
+
+def test_search_float64():
+    knn = 10
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 200.0, size=(1000, 3))
+    # UTM-like coordinates, which are not representable in float32 at centimeter precision
+    xyz_utm = xyz + np.array([500000.0, 5000000.0, 100.0])
+    _, k_legacy = KDTree(xyz).query(xyz, k=knn, workers=-1)
+    k_new, sq_dist = pgeof.knn_search(xyz_utm, xyz_utm, knn)
+    np.testing.assert_equal(k_legacy, k_new)
+    assert sq_dist.dtype == np.float64
+    _, sq_dist32 = pgeof.knn_search(xyz_utm, xyz_utm, knn, float32_distances=True)
+    assert sq_dist32.dtype == np.float32
+    np.testing.assert_allclose(sq_dist32, sq_dist, rtol=1e-6)
+    k_radius, sq_dist = pgeof.radius_search(xyz_utm, xyz_utm, 20.0, knn, float32_distances=True)
+    assert k_radius.shape == (1000, knn) and sq_dist.dtype == np.float32
+
+
+def test_search_implicit_backend():
+    knn = 10
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 200.0, size=(1000, 3)).astype(np.float32)
+    _, d_nanoflann = pgeof.knn_search(xyz, xyz, knn)
+    _, d_implicit = pgeof.knn_search(xyz, xyz, knn, backend="implicit")
+    np.testing.assert_equal(d_nanoflann, d_implicit)
+    k_nanoflann, _ = pgeof.radius_search(xyz, xyz, 20.0, knn, exclude_self=True)
+    k_implicit, _ = pgeof.radius_search(xyz, xyz, 20.0, knn, exclude_self=True, backend="implicit")
+    np.testing.assert_equal(k_nanoflann >= 0, k_implicit >= 0)
+    features = [EFeatureID.Linearity, EFeatureID.Verticality]
+    f_nanoflann = pgeof.compute_features_selected(xyz, 20.0, 30, features)
+    f_implicit = pgeof.compute_features_selected(xyz, 20.0, 30, features, backend="implicit")
+    np.testing.assert_allclose(f_nanoflann, f_implicit, rtol=1e-5, atol=1e-6)
+
+
+def test_search_axis_weights():
+    knn = 10
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 200.0, size=(1000, 3)).astype(np.float32)
+    # Weighting z by 4 is the same as searching a copy of the cloud with z scaled by 2
+    xyz_scaled = xyz * np.array([1.0, 1.0, 2.0], dtype=np.float32)
+    _, sq_dist_scaled = pgeof.knn_search(xyz_scaled, xyz_scaled, knn)
+    for backend in ["nanoflann", "implicit"]:
+        _, sq_dist = pgeof.knn_search(xyz, xyz, knn, backend=backend, weights=(1.0, 1.0, 4.0))
+        np.testing.assert_allclose(sq_dist, sq_dist_scaled, rtol=1e-5)
+    # Features are computed on the original coordinates, from the neighbors of the weighted search
+    features = [EFeatureID.Linearity]
+    f_weighted = pgeof.compute_features_selected(xyz, 20.0, 30, features, weights=(1.0, 1.0, 4.0))
+    knn_radius, _ = pgeof.radius_search(xyz, xyz, 20.0, 30, weights=(1.0, 1.0, 4.0))
+    nn_ptr = np.r_[0, (knn_radius >= 0).sum(axis=1).cumsum()].astype("uint32")
+    nn = knn_radius[knn_radius >= 0].astype("uint32")
+    f_csr = pgeof.compute_features(xyz, nn, nn_ptr, k_min=2)
+    has_features = np.diff(nn_ptr) >= 2
+    np.testing.assert_allclose(f_weighted[has_features, 0], f_csr[has_features, 0], atol=1e-4)
+
+
+def test_search_feature_space():
+    knn = 10
+    rng = np.random.default_rng()
+    for dim in [2, 11, 20]:
+        features = rng.uniform(0.0, 1.0, size=(1000, dim)).astype(np.float32)
+        d_legacy, k_legacy = KDTree(features).query(features, k=knn, workers=-1)
+        k_new, sq_dist = pgeof.knn_search(features, features, knn)
+        np.testing.assert_equal(k_legacy[:, 0], k_new[:, 0])
+        np.testing.assert_allclose(d_legacy**2, sq_dist, rtol=1e-4, atol=1e-6)
+        k_radius, _ = pgeof.radius_search(features.astype(np.float64), features.astype(np.float64), 0.5, knn)
+        assert k_radius.shape == (1000, knn)
+
+
+def test_cloud_distance():
+    rng = np.random.default_rng()
+    data = rng.uniform(0.0, 1.0, size=(2000, 3)).astype(np.float32)
+    query = rng.uniform(0.0, 1.0, size=(1500, 3)).astype(np.float32)
+    d_ref, _ = KDTree(data).query(query, k=1, workers=-1)
+    stats, percentiles, dist = pgeof.cloud_distance(data, query, percentiles=[5, 50, 95], return_distances=True)
+    np.testing.assert_allclose(dist, d_ref, rtol=1e-5, atol=1e-6)
+    np.testing.assert_allclose(stats["mean"], d_ref.mean(), rtol=1e-4)
+    np.testing.assert_allclose(stats["max"], d_ref.max(), rtol=1e-5)
+    np.testing.assert_allclose(percentiles, np.percentile(d_ref, [5, 50, 95]), rtol=1e-4)
+    assert pgeof.cloud_distance(data, query)[2] is None
+    d_back, _ = KDTree(query).query(data, k=1, workers=-1)
+    chamfer = (d_ref**2).mean() + (d_back**2).mean()
+    np.testing.assert_allclose(pgeof.chamfer_distance(data, query, backend="implicit"), chamfer, rtol=1e-4)
+
+
+def test_m3c2():
+    rng = np.random.default_rng()
+    epoch1 = rng.uniform(0.0, 1.0, size=(20000, 3)).astype(np.float32)
+    epoch1[:, 2] = rng.normal(0.0, 0.01, size=20000)
+    epoch2 = epoch1 + rng.normal(0.0, 0.01, size=epoch1.shape).astype(np.float32)
+    epoch2[:, 2] += 0.1
+    core_points = epoch1[::100]
+    dist, lod, normals, counts = pgeof.m3c2(epoch1, epoch2, core_points, 0.05, 0.03, 0.3)
+    assert normals.shape == (200, 3) and counts.shape == (200, 2)
+    np.testing.assert_allclose(np.abs(normals[:, 2]), 1.0, atol=0.05)
+    np.testing.assert_allclose(np.nanmedian(dist), 0.1, atol=0.005)
+    assert np.all(np.abs(dist) > lod)
+
+
+def test_orient_normals():
+    rng = np.random.default_rng()
+    xyz = rng.normal(size=(5000, 3)).astype(np.float32)
+    xyz /= np.linalg.norm(xyz, axis=1, keepdims=True)
+    signs = rng.choice([-1.0, 1.0], size=(5000, 1)).astype(np.float32)
+    normals = np.ascontiguousarray(xyz * signs)
+    knn, _ = pgeof.knn_search(xyz, xyz, 10, exclude_self=True)
+    nn = knn.flatten().astype(np.uint32)
+    nn_ptr = np.arange(0, nn.size + 1, 10, dtype=np.uint32)
+    oriented = pgeof.orient_normals(xyz, normals, nn, nn_ptr)
+    np.testing.assert_allclose(oriented, xyz, atol=1e-6)
+    oriented = pgeof.orient_normals(xyz, normals, viewpoint=(0.0, 0.0, 0.0))
+    np.testing.assert_allclose(oriented, -xyz, atol=1e-6)
+
+
+def test_fpfh():
+    rng = np.random.default_rng()
+    xyz = rng.normal(size=(3000, 3))
+    xyz /= np.linalg.norm(xyz, axis=1, keepdims=True)
+    normals = xyz.copy()
+    fpfh = pgeof.compute_fpfh(xyz, normals, 0.2, 50)
+    assert fpfh.shape == (3000, 33)
+    # Each of the 3 histograms of a descriptor sums to 100 (own histogram) + 100 (weighted neighbors)
+    np.testing.assert_allclose(fpfh.reshape(-1, 3, 11).sum(axis=2), 200.0, rtol=1e-6)
+    rotation, _ = np.linalg.qr(rng.normal(size=(3, 3)))
+    fpfh_rotated = pgeof.compute_fpfh(xyz @ rotation.T, normals @ rotation.T, 0.2, 50)
+    np.testing.assert_allclose(fpfh_rotated, fpfh, atol=1e-6)
+
+
+def test_normal_features():
+    rng = np.random.default_rng()
+    xyz = rng.uniform(-1.0, 1.0, size=(5000, 3))
+    xyz[:, 2] = np.maximum(xyz[:, 0] - 0.5, 0.0)
+    features = pgeof.compute_normal_features(xyz, 0.1, 0.05, 60, k_min=3)
+    assert features.shape == (5000, 5)
+    np.testing.assert_allclose(np.linalg.norm(features[:, :3], axis=1), 1.0, rtol=1e-6)
+    flat = (np.abs(xyz[:, 0] - 0.5) > 0.25) & (np.abs(xyz[:, :2]) < 0.9).all(axis=1)
+    np.testing.assert_allclose(features[flat, 3:], 0.0, atol=1e-3)
+    fold = np.abs(xyz[:, 0] - 0.5) < 0.02
+    assert features[fold, 3].mean() > 0.1
+    knn, _ = pgeof.knn_search(xyz, xyz, 16)
+    nn = knn.flatten().astype(np.uint32)
+    nn_ptr = np.arange(0, nn.size + 1, 16, dtype=np.uint32)
+    features_csr = pgeof.compute_normal_features(xyz, nn, nn_ptr, k_small=8)
+    np.testing.assert_allclose(features_csr[flat, 3:], 0.0, atol=1e-3)
+
+
+def test_neighborhood_statistics():
+    xyz, nn, nn_ptr = random_nn(2000, 10)
+    rng = np.random.default_rng()
+    attributes = rng.integers(0, 255, size=(2000, 3)).astype(np.float32)
+    stats = pgeof.neighborhood_statistics(attributes, nn, nn_ptr, ["mean", "std", "min", "max", "median"])
+    assert stats.shape == (2000, 5, 3)
+    for i in range(0, 2000, 101):
+        values = attributes[nn[nn_ptr[i] : nn_ptr[i + 1]]]
+        expected = [values.mean(0), values.std(0), values.min(0), values.max(0), np.median(values, axis=0)]
+        np.testing.assert_allclose(stats[i], np.stack(expected), rtol=1e-5)
+    radius_stats = pgeof.neighborhood_statistics(xyz, attributes, 30.0, 20, ["mean"])
+    features = pgeof.compute_features_selected(xyz, 30.0, 20, [EFeatureID.Verticality], attributes=attributes)
+    assert features.shape == (2000, 4)
+    np.testing.assert_allclose(features[:, 1:], radius_stats[:, 0, :], rtol=1e-5)
+    features_adaptive = pgeof.compute_features_selected_adaptive(
+        xyz, np.full(2000, 30.0, dtype=np.float32), 20, [EFeatureID.Verticality], attributes=attributes
+    )
+    np.testing.assert_array_equal(features_adaptive, features)
+    radii = [15.0, 30.0]
+    features_multiradius = pgeof.compute_features_selected(
+        xyz, radii, 200, [EFeatureID.Verticality], attributes=attributes, statistics=["mean", "max"]
+    )
+    assert features_multiradius.shape == (2000, 2, 7)
+    for i_radius, radius in enumerate(radii):
+        radius_stats = pgeof.neighborhood_statistics(xyz, attributes, radius, 200, ["mean", "max"])
+        np.testing.assert_allclose(
+            features_multiradius[:, i_radius, 1:], radius_stats.reshape(2000, 6), rtol=1e-5, equal_nan=True
+        )
+
+
+def test_quadric_curvatures():
+    rng = np.random.default_rng()
+    direction = rng.normal(size=(20000, 3))
+    xyz = 2.0 * direction / np.linalg.norm(direction, axis=1, keepdims=True)
+    curvatures = [
+        EFeatureID.PrincipalCurvature1,
+        EFeatureID.PrincipalCurvature2,
+        EFeatureID.MeanCurvature,
+        EFeatureID.GaussianCurvature,
+    ]
+    features = pgeof.compute_features_selected(xyz, 0.5, 2000, curvatures)
+    # Normals are oriented towards +z, so the upper cap bends away from them
+    top = xyz[:, 2] > 1.9
+    np.testing.assert_allclose(features[top, :3], -0.5, atol=0.05)
+    np.testing.assert_allclose(features[top, 3], 0.25, atol=0.05)
+    multiradius = pgeof.compute_features_selected(xyz, radii=[0.3, 0.5], max_knn=2000, selected_features=curvatures)
+    np.testing.assert_allclose(multiradius[:, 1], features, rtol=1e-5, atol=1e-6)
+
+
+def test_outlier_filter():
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 1.0, size=(3000, 3)).astype(np.float32)
+    xyz[:10] += 10.0 + rng.uniform(0.0, 10.0, size=(10, 3)).astype(np.float32)
+    mask, nn, nn_ptr = pgeof.statistical_outlier_filter(xyz, 10, 2.0)
+    assert mask.dtype == bool and mask.shape == (3000,)
+    assert nn is None and nn_ptr is None
+    assert not mask[:10].any()
+    indices, nn, nn_ptr = pgeof.statistical_outlier_filter(xyz, 10, 2.0, return_indices=True, return_neighbors=True)
+    np.testing.assert_equal(indices, np.flatnonzero(mask))
+    assert nn_ptr.shape == (indices.size + 1,)
+    np.testing.assert_equal(nn[nn_ptr[:-1]], np.arange(indices.size))
+    features = pgeof.compute_features(xyz[indices], nn, nn_ptr)
+    assert features.shape == (indices.size, 11)
+    tree = KDTree(xyz)
+    counts = np.array([len(n) - 1 for n in tree.query_ball_point(xyz, 0.1)])
+    mask, _, _ = pgeof.radius_outlier_filter(xyz, 0.1, 3)
+    np.testing.assert_equal(mask, counts >= 3)
+
+
+def test_farthest_point_sampling():
+    rng = np.random.default_rng()
+    xyz = rng.uniform(0.0, 1.0, size=(2000, 3)).astype(np.float32)
+    samples = pgeof.farthest_point_sampling(xyz, 100, start_index=5)
+    assert samples.dtype == np.uint32 and samples.shape == (100,)
+    expected = [5]
+    sq_dist = np.full(2000, np.inf, dtype=np.float32)
+    for _ in range(99):
+        sq_dist = np.minimum(sq_dist, ((xyz - xyz[expected[-1]]) ** 2).sum(axis=1))
+        expected.append(int(np.argmax(sq_dist)))
+    np.testing.assert_equal(samples, expected)
+    approximate = pgeof.farthest_point_sampling(xyz, 100, voxel_size=0.1)
+    assert np.unique(approximate).size == 100
+
+
+def test_dbscan():
+    rng = np.random.default_rng()
+    centers = np.array([[0.0, 0.0, 0.0], [1.0, 0.0, 0.0], [0.0, 1.0, 0.0]])
+    xyz = (centers[rng.integers(0, 3, size=3000)] + rng.normal(0.0, 0.03, size=(3000, 3))).astype(np.float32)
+    xyz[:10] = rng.uniform(3.0, 10.0, size=(10, 3))
+    labels = pgeof.dbscan(xyz, 0.05, min_points=5)
+    assert labels.dtype == np.int32 and labels.shape == (3000,)
+    assert (labels[:10] == -1).all()
+    assert labels.max() == 2
+    for center in centers:
+        cluster = labels[10:][np.linalg.norm(xyz[10:] - center, axis=1) < 0.05]
+        assert np.unique(cluster).size == 1 and cluster[0] >= 0
+    mask = xyz[:, 0] < 0.5
+    masked = pgeof.dbscan(xyz, 0.05, min_points=1, min_cluster_size=5, mask=mask)
+    assert (masked[~mask] == -1).all()
+    assert masked.max() == 1
+
+
+def test_region_growing():
+    rng = np.random.default_rng()
+    xyz = rng.uniform(-1.0, 1.0, size=(3000, 3)).astype(np.float32)
+    xyz[:, 2] = np.maximum(xyz[:, 0], 0.0)
+    normals = np.zeros_like(xyz)
+    normals[:, 2] = 1.0
+    normals[xyz[:, 0] > 0] = [-np.sqrt(0.5), 0.0, np.sqrt(0.5)]
+    knn, _ = pgeof.knn_search(xyz, xyz, 10)
+    nn = knn.flatten().astype(np.uint32)
+    nn_ptr = np.arange(0, nn.size + 1, 10, dtype=np.uint32)
+    labels = pgeof.region_growing(normals, nn, nn_ptr, np.radians(10.0), min_region_size=100)
+    assert labels.dtype == np.int32 and labels.shape == (3000,)
+    assert np.unique(labels[xyz[:, 0] < 0]).size == 1
+    assert np.unique(labels[xyz[:, 0] > 0]).size == 1
+    assert labels[xyz[:, 0] < 0][0] != labels[xyz[:, 0] > 0][0]
+    feature = (np.arange(3000) % 10 != 0).astype(np.float32)
+    labels = pgeof.region_growing(
+        normals, nn, nn_ptr, np.radians(60.0), feature=feature, min_feature=0.5, min_region_size=10
+    )
+    assert (labels[feature < 0.5] == -1).all()
+    assert labels.max() == 0
+
+
+def test_region_growing_invalid_normals():
+    # Two perpendicular planes only linked through a point with a null, then NaN, normal
+    normals = np.array([[0, 0, 1], [0, 0, 1], [0, 0, 0], [1, 0, 0], [1, 0, 0]], dtype=np.float32)
+    nn = np.array([1, 2, 0, 2, 0, 1, 3, 4, 4, 2, 3, 2], dtype=np.uint32)
+    nn_ptr = np.array([0, 2, 4, 8, 10, 12], dtype=np.uint32)
+    for invalid in [0.0, np.nan]:
+        normals[2] = invalid
+        labels = pgeof.region_growing(normals, nn, nn_ptr, np.radians(10.0))
+        np.testing.assert_equal(labels, [0, 0, -1, 1, 1])